@@ -0,0 +1,175 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace mcfp::detail
+{
+
+// --------------------------------------------------------------------
+// Helpers for the binary config cache. The cache is only ever read by
+// the program that wrote it, or by the same program on the same machine,
+// so values are stored in native byte order. The header records the byte
+// order and the sizes of the integers used, a mismatch simply invalidates
+// the cache.
+
+// A fast, non-cryptographic hash processing eight bytes at a time
+
+inline uint64_t hash_bytes(std::string_view data, uint64_t h = 0x9e3779b97f4a7c15ULL)
+{
+	const char *p = data.data();
+	size_t n = data.length();
+
+	for (; n >= 8; p += 8, n -= 8)
+	{
+		uint64_t w;
+		std::memcpy(&w, p, 8);
+		h = (h ^ w) * 0xff51afd7ed558ccdULL;
+		h ^= h >> 32;
+	}
+
+	uint64_t w = 0;
+	std::memcpy(&w, p, n);
+	h = (h ^ w ^ (static_cast<uint64_t>(data.length()) << 56)) * 0xc4ceb9fe1a85ec53ULL;
+	return h ^ (h >> 29);
+}
+
+struct config_cache_header
+{
+	static constexpr char kMagic[8] = { 'm', 'c', 'f', 'p', 'c', 'a', 'c', 'h' };
+	static constexpr uint32_t kVersion = 2;
+	static constexpr uint32_t kByteOrder = 0x01020304;
+
+	char m_magic[8];
+	uint32_t m_version;
+	uint32_t m_byte_order;
+	uint64_t m_source_size;
+	int64_t m_source_mtime;
+	uint64_t m_source_hash;
+	uint64_t m_schema_hash;
+
+	config_cache_header() = default;
+
+	config_cache_header(uint64_t source_size, int64_t source_mtime, uint64_t source_hash, uint64_t schema_hash)
+		: m_version(kVersion)
+		, m_byte_order(kByteOrder)
+		, m_source_size(source_size)
+		, m_source_mtime(source_mtime)
+		, m_source_hash(source_hash)
+		, m_schema_hash(schema_hash)
+	{
+		std::memcpy(m_magic, kMagic, sizeof(kMagic));
+	}
+
+	bool operator==(const config_cache_header &rhs) const
+	{
+		return std::memcmp(m_magic, rhs.m_magic, sizeof(m_magic)) == 0 and
+		       m_version == rhs.m_version and
+		       m_byte_order == rhs.m_byte_order and
+		       m_source_size == rhs.m_source_size and
+		       m_source_mtime == rhs.m_source_mtime and
+		       m_source_hash == rhs.m_source_hash and
+		       m_schema_hash == rhs.m_schema_hash;
+	}
+};
+
+static_assert(std::is_trivially_copyable_v<config_cache_header>);
+
+// Appending to, and reading from the cache image
+
+class config_cache_writer
+{
+  public:
+	template <typename T, std::enable_if_t<std::is_trivially_copyable_v<T>, int> = 0>
+	void write(const T &value)
+	{
+		m_data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	void write(std::string_view text)
+	{
+		write(static_cast<uint32_t>(text.length()));
+		m_data.append(text);
+	}
+
+	std::string &data()
+	{
+		return m_data;
+	}
+
+  private:
+	std::string m_data;
+};
+
+// The reader fails, returning false, when reading past the end of the data
+
+class config_cache_reader
+{
+  public:
+	config_cache_reader(std::string_view data)
+		: m_data(data)
+	{
+	}
+
+	template <typename T, std::enable_if_t<std::is_trivially_copyable_v<T>, int> = 0>
+	bool read(T &value)
+	{
+		if (m_data.length() < sizeof(T))
+			return false;
+
+		std::memcpy(&value, m_data.data(), sizeof(T));
+		m_data.remove_prefix(sizeof(T));
+		return true;
+	}
+
+	bool read(std::string_view &text)
+	{
+		uint32_t length;
+		if (not read(length) or m_data.length() < length)
+			return false;
+
+		text = m_data.substr(0, length);
+		m_data.remove_prefix(length);
+		return true;
+	}
+
+	bool empty() const
+	{
+		return m_data.empty();
+	}
+
+  private:
+	std::string_view m_data;
+};
+
+} // namespace mcfp::detail
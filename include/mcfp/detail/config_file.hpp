@@ -0,0 +1,269 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <mcfp/error.hpp>
+#include <mcfp/detail/mapped_file.hpp>
+#include <mcfp/detail/name_index.hpp>
+#include <mcfp/detail/scan.hpp>
+
+namespace mcfp::detail
+{
+
+// --------------------------------------------------------------------
+// A [section] in a config file. The options that follow it are named
+// after the section, a dot and the name in the file. The hash of the
+// section name and the dot is calculated once, see name_index::find.
+
+struct config_section
+{
+	config_section() = default;
+
+	explicit config_section(std::string_view name)
+		: m_name(name)
+		, m_hash(hash_name(".", hash_name(name)))
+	{
+	}
+
+	std::string_view m_name; // empty before the first section
+	uint64_t m_hash = kNameHashSeed;
+};
+
+// --------------------------------------------------------------------
+// Tokenize the text of a config file. Each line contains either a name
+// and a value separated by an equals character, the name of a flag, a
+// section name between square brackets, or a comment starting with a
+// hash or semicolon character.
+//
+// For each option found \a handler is called with the current section,
+// the name and, if an equals character was present, the value. These
+// are views on \a text, except for the name of a section that started
+// before \a text. The value extends to the end of the line, trailing
+// white space included. The section at the end of \a text is left in
+// \a section. Tokenizing stops at the first error, which may also be
+// set by the handler in \a ec. Returns the offset in \a text where
+// tokenizing stopped, for a syntax error that is the offending character.
+
+template <typename Handler>
+size_t tokenize_config_text(std::string_view text, config_section &section, Handler &&handler, std::error_code &ec,
+	const scanner &scan = scanner::best())
+{
+	const char *p = text.data();
+	const char *const end = p + text.length();
+
+	// White space runs are typically very short
+	auto skip_space = [&scan, end](const char *s)
+	{
+		return (s != end and is_space(*s)) ? scan.skip_space(s + 1, end) : s;
+	};
+
+	while (not ec)
+	{
+		p = skip_space(p);
+
+		if (p == end)
+			break;
+
+		if (is_eoln(*p))
+		{
+			++p;
+			continue;
+		}
+
+		if (*p == '#' or *p == ';')
+		{
+			p = scan.skip_line(p + 1, end);
+			continue;
+		}
+
+		if (*p == '[')
+		{
+			p = skip_space(p + 1);
+
+			const char *name = p;
+			while (p != end and (is_name_char(*p) or *p == '.'))
+				++p;
+
+			std::string_view section_name(name, p - name);
+
+			p = skip_space(p);
+			if (section_name.empty() or p == end or *p != ']')
+			{
+				ec = make_error_code(config_error::invalid_config_file);
+				break;
+			}
+
+			p = skip_space(p + 1);
+			if (p != end and not is_eoln(*p))
+			{
+				ec = make_error_code(config_error::invalid_config_file);
+				break;
+			}
+
+			section = config_section(section_name);
+			continue;
+		}
+
+		if (not is_name_char(*p))
+		{
+			ec = make_error_code(config_error::invalid_config_file);
+			break;
+		}
+
+		const char *name = p;
+		p = scan.skip_name(p + 1, end);
+
+		std::string_view option_name(name, p - name);
+
+		p = skip_space(p);
+
+		if (p == end or is_eoln(*p))
+			handler(section, option_name, std::optional<std::string_view>{}, ec);
+		else if (*p == '=')
+		{
+			const char *value = skip_space(p + 1);
+			p = scan.skip_line(value, end);
+			handler(section, option_name, std::optional<std::string_view>{ std::string_view(value, p - value) }, ec);
+		}
+		else
+			ec = make_error_code(config_error::invalid_config_file);
+	}
+
+	return p - text.data();
+}
+
+// Tokenize \a text starting outside any section
+
+template <typename Handler>
+size_t tokenize_config_text(std::string_view text, Handler &&handler, std::error_code &ec,
+	const scanner &scan = scanner::best())
+{
+	config_section section;
+	return tokenize_config_text(text, section, std::forward<Handler>(handler), ec, scan);
+}
+
+// --------------------------------------------------------------------
+// A config file read for an include directive, together with the
+// result of tokenizing it. The tokens are views on a copy of the file
+// contents, the file itself is not kept open. A mapping would turn a
+// file truncated while in the cache into a SIGBUS or corrupted values.
+
+struct tokenized_file
+{
+	struct token
+	{
+		config_section m_section;
+		std::string_view m_name;
+		std::optional<std::string_view> m_value;
+	};
+
+	std::filesystem::path m_path;
+	uint64_t m_size = 0;
+	int64_t m_mtime = 0;
+	std::string m_text;
+	std::vector<token> m_tokens;
+	std::error_code m_ec; // the tokenizer error, the tokens up to the error are kept
+};
+
+// The size and modification time of \a path, used to decide whether a
+// cached version of a file is still up to date
+
+inline std::pair<uint64_t, int64_t> file_stamp(const std::filesystem::path &path, std::error_code &ec)
+{
+	auto size = std::filesystem::file_size(path, ec);
+	if (ec)
+		return {};
+
+	auto mtime = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		return {};
+
+	return { size, static_cast<int64_t>(mtime.time_since_epoch().count()) };
+}
+
+// Included files are read and tokenized once, and then reused for as
+// long as their size and modification time do not change. The cache is
+// used concurrently when parsing a config directory.
+
+class include_cache
+{
+  public:
+	// Return the tokenized contents of the file with canonical path \a path
+	std::shared_ptr<const tokenized_file> get(const std::filesystem::path &path, std::error_code &ec)
+	{
+		auto [size, mtime] = file_stamp(path, ec);
+		if (ec)
+			return {};
+
+		std::lock_guard lock(m_mutex);
+
+		auto i = m_files.find(path.native());
+		if (i != m_files.end() and i->second->m_size == size and i->second->m_mtime == mtime)
+			return i->second;
+
+		auto file = std::make_shared<tokenized_file>();
+		file->m_path = path;
+		file->m_size = size;
+		file->m_mtime = mtime;
+
+		{
+			mapped_file mapped(path, ec);
+			if (ec)
+				return {};
+			file->m_text.assign(mapped.text());
+		}
+
+		tokenize_config_text(file->m_text, [&tokens = file->m_tokens](const config_section &section, std::string_view name, std::optional<std::string_view> value, std::error_code &)
+		{
+			tokens.push_back({ section, name, value });
+		}, file->m_ec);
+
+		if (i != m_files.end())
+			i->second = file;
+		else
+			m_files.emplace(path.native(), file);
+
+		return file;
+	}
+
+  private:
+	std::mutex m_mutex;
+	std::unordered_map<std::filesystem::path::string_type, std::shared_ptr<const tokenized_file>> m_files;
+};
+
+} // namespace mcfp::detail
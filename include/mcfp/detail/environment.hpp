@@ -0,0 +1,128 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+#include <array>
+#include <optional>
+#include <string_view>
+
+#if defined(__APPLE__)
+#include <crt_externs.h>
+#elif not defined(_WIN32)
+extern "C" char **environ;
+#endif
+
+namespace mcfp::detail
+{
+
+// --------------------------------------------------------------------
+// Return the environment of this process, an array of NAME=value
+// strings terminated by a nullptr
+
+inline const char *const *environment()
+{
+#if defined(_WIN32)
+	return _environ;
+#elif defined(__APPLE__)
+	return *_NSGetEnviron();
+#else
+	return environ;
+#endif
+}
+
+// --------------------------------------------------------------------
+// Convert the name of an environment variable, with the prefix removed,
+// to the name of an option, written in \a buffer. Letters are converted
+// to lower case, a double underscore separates a section from the name
+// and a single underscore becomes a hyphen. With \a keep_underscore a
+// single underscore is kept as is, for options named like cache_size.
+// Returns an empty view if \a name does not fit in \a buffer.
+
+template <size_t N>
+std::string_view environment_to_option_name(std::string_view name, std::array<char, N> &buffer, bool keep_underscore)
+{
+	size_t n = 0;
+
+	for (size_t i = 0; i < name.length(); ++i)
+	{
+		if (n == N)
+			return {};
+
+		char ch = name[i];
+
+		if (ch >= 'A' and ch <= 'Z')
+			ch += 'a' - 'A';
+		else if (ch == '_' and i + 1 < name.length() and name[i + 1] == '_')
+		{
+			ch = '.';
+			++i;
+		}
+		else if (ch == '_' and not keep_underscore)
+			ch = '-';
+
+		buffer[n++] = ch;
+	}
+
+	return { buffer.data(), n };
+}
+
+// --------------------------------------------------------------------
+// Interpret the value of an environment variable bound to a flag. Returns
+// true for 1, true, yes and on, false for 0, false, no, off and an empty
+// value, ignoring case. Anything else returns an empty optional.
+
+inline std::optional<bool> environment_flag_value(std::string_view value)
+{
+	auto equals = [value](std::string_view word)
+	{
+		if (value.length() != word.length())
+			return false;
+
+		for (size_t i = 0; i < word.length(); ++i)
+		{
+			char ch = value[i];
+			if (ch >= 'A' and ch <= 'Z')
+				ch += 'a' - 'A';
+			if (ch != word[i])
+				return false;
+		}
+
+		return true;
+	};
+
+	if (equals("1") or equals("true") or equals("yes") or equals("on"))
+		return true;
+
+	if (value.empty() or equals("0") or equals("false") or equals("no") or equals("off"))
+		return false;
+
+	return {};
+}
+
+} // namespace mcfp::detail
@@ -0,0 +1,187 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cerrno>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mcfp::detail
+{
+
+// --------------------------------------------------------------------
+// Read only access to the contents of a file. Regular files are mapped
+// into memory when the platform supports it, other files, like pipes,
+// and files on platforms without mmap are read into a buffer.
+//
+// A file opened as writable is mapped copy-on-write, the contents can
+// then be modified in place through data() without changing the file.
+// Only the pages written to are copied.
+//
+// The contents are only valid as long as this object exists and the
+// file is not truncated by someone else in the mean time.
+
+class mapped_file
+{
+  public:
+	mapped_file() = default;
+
+	mapped_file(const std::filesystem::path &file, std::error_code &ec, bool writable = false)
+	{
+#if __has_include(<sys/mman.h>)
+		int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			ec = std::error_code(errno, std::system_category());
+			return;
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) == 0 and S_ISREG(st.st_mode) and st.st_size > 0)
+		{
+			void *data = ::mmap(nullptr, st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				::madvise(data, st.st_size, MADV_SEQUENTIAL);
+				m_data = static_cast<const char *>(data);
+				m_size = st.st_size;
+				m_mapped = true;
+			}
+		}
+
+		// Not a regular file, or mapping failed, read it instead
+		while (not m_mapped)
+		{
+			const size_t kChunk = 64 * 1024;
+			size_t size = m_buffer.size();
+			m_buffer.resize(size + kChunk);
+
+			auto r = ::read(fd, m_buffer.data() + size, kChunk);
+			m_buffer.resize(size + (r > 0 ? r : 0));
+
+			// interrupted by a signal before anything was read, try again
+			if (r < 0 and errno == EINTR)
+				continue;
+
+			if (r < 0)
+				ec = std::error_code(errno, std::system_category());
+
+			if (r <= 0)
+				break;
+		}
+
+		::close(fd);
+#else
+		std::ifstream is(file, std::ios::binary);
+		if (not is.is_open())
+		{
+			ec = std::make_error_code(std::errc::no_such_file_or_directory);
+			return;
+		}
+
+		m_buffer.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+#endif
+
+		if (not m_mapped)
+		{
+			m_data = m_buffer.data();
+			m_size = m_buffer.size();
+		}
+	}
+
+	mapped_file(const mapped_file &) = delete;
+	mapped_file &operator=(const mapped_file &) = delete;
+
+	mapped_file(mapped_file &&rhs) noexcept
+	{
+		swap(rhs);
+	}
+
+	mapped_file &operator=(mapped_file &&rhs) noexcept
+	{
+		if (this != &rhs)
+		{
+			mapped_file tmp(std::move(rhs));
+			swap(tmp);
+		}
+		return *this;
+	}
+
+	~mapped_file()
+	{
+#if __has_include(<sys/mman.h>)
+		if (m_mapped)
+			::munmap(const_cast<char *>(m_data), m_size);
+#endif
+	}
+
+	std::string_view text() const
+	{
+		return { m_data, m_size };
+	}
+
+	// The contents, which may only be modified if the file was opened
+	// as writable
+	char *data()
+	{
+		return const_cast<char *>(m_data);
+	}
+
+  private:
+	void swap(mapped_file &rhs) noexcept
+	{
+		std::swap(m_buffer, rhs.m_buffer);
+		std::swap(m_data, rhs.m_data);
+		std::swap(m_size, rhs.m_size);
+		std::swap(m_mapped, rhs.m_mapped);
+
+		// views on a buffer must follow the buffer
+		if (not m_mapped)
+			m_data = m_buffer.data();
+		if (not rhs.m_mapped)
+			rhs.m_data = rhs.m_buffer.data();
+	}
+
+	std::string m_buffer;
+	const char *m_data = nullptr;
+	size_t m_size = 0;
+	bool m_mapped = false;
+};
+
+} // namespace mcfp::detail
@@ -0,0 +1,192 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace mcfp::detail
+{
+
+// --------------------------------------------------------------------
+// A hashed index over option names. The index is built once, when the
+// config object is initialised, and after that a lookup by name costs
+// a hash calculation and, typically, a single string compare, no matter
+// how many options were registered.
+//
+// The table uses open addressing with linear probing and is kept at
+// most half full. The keys are views on the names stored in the options
+// themselves, so the options must outlive the index.
+
+constexpr uint64_t kNameHashSeed = 0xcbf29ce484222325ULL;
+
+/// The hash function used for names, FNV-1a. Hashing a name in parts gives
+/// the same result as hashing it at once when \a h is the hash of the
+/// preceding part.
+constexpr uint64_t hash_name(std::string_view key, uint64_t h = kNameHashSeed)
+{
+	for (unsigned char ch : key)
+		h = (h ^ ch) * 0x100000001b3ULL;
+	return h;
+}
+
+template <typename T>
+class name_index
+{
+  public:
+	name_index() = default;
+
+	/// Prepare the index to hold \a count entries
+	void reserve(size_t count)
+	{
+		size_t capacity = 8;
+		while (capacity < 2 * count)
+			capacity *= 2;
+
+		m_table.assign(capacity, {});
+		m_mask = capacity - 1;
+		m_size = 0;
+	}
+
+	/// Add \a value to the index using the key \a key. If the key was
+	/// already present, the first entry is kept and false is returned.
+	bool insert(std::string_view key, T *value)
+	{
+		if (2 * (m_size + 1) > m_table.size())
+			rehash(2 * m_table.size());
+
+		auto h = hash(key);
+		for (size_t ix = h & m_mask;; ix = (ix + 1) & m_mask)
+		{
+			auto &e = m_table[ix];
+
+			if (e.m_value == nullptr)
+			{
+				e = { h, key, value };
+				++m_size;
+				return true;
+			}
+
+			if (e.m_hash == h and e.m_key == key)
+				return false;
+		}
+	}
+
+	/// Return the value stored for \a key or nullptr if it is not known
+	T *find(std::string_view key) const
+	{
+		if (m_size == 0)
+			return nullptr;
+
+		auto h = hash(key);
+		for (size_t ix = h & m_mask;; ix = (ix + 1) & m_mask)
+		{
+			auto &e = m_table[ix];
+
+			if (e.m_value == nullptr)
+				return nullptr;
+
+			if (e.m_hash == h and e.m_key == key)
+				return e.m_value;
+		}
+	}
+
+	/// Return the value stored for the key \a prefix followed by a dot and
+	/// \a key, or nullptr if it is not known. \a prefix_hash is the hash of
+	/// \a prefix and the dot, so that a prefix used for many keys is hashed
+	/// only once.
+	T *find(std::string_view prefix, uint64_t prefix_hash, std::string_view key) const
+	{
+		if (m_size == 0)
+			return nullptr;
+
+		const size_t length = prefix.length() + 1 + key.length();
+
+		auto h = hash(key, prefix_hash);
+		for (size_t ix = h & m_mask;; ix = (ix + 1) & m_mask)
+		{
+			auto &e = m_table[ix];
+
+			if (e.m_value == nullptr)
+				return nullptr;
+
+			if (e.m_hash == h and e.m_key.length() == length and
+				e.m_key.compare(0, prefix.length(), prefix) == 0 and
+				e.m_key[prefix.length()] == '.' and
+				e.m_key.compare(prefix.length() + 1, key.length(), key) == 0)
+			{
+				return e.m_value;
+			}
+		}
+	}
+
+	size_t size() const { return m_size; }
+
+	/// The hash function used, see hash_name
+	static constexpr uint64_t hash(std::string_view key, uint64_t h = kNameHashSeed)
+	{
+		return hash_name(key, h);
+	}
+
+  private:
+	struct entry
+	{
+		uint64_t m_hash = 0;
+		std::string_view m_key;
+		T *m_value = nullptr;
+	};
+
+	void rehash(size_t capacity)
+	{
+		if (capacity < 8)
+			capacity = 8;
+
+		std::vector<entry> table(capacity);
+		size_t mask = capacity - 1;
+
+		for (auto &e : m_table)
+		{
+			if (e.m_value == nullptr)
+				continue;
+
+			size_t ix = e.m_hash & mask;
+			while (table[ix].m_value != nullptr)
+				ix = (ix + 1) & mask;
+			table[ix] = e;
+		}
+
+		std::swap(m_table, table);
+		m_mask = mask;
+	}
+
+	std::vector<entry> m_table;
+	size_t m_mask = 0;
+	size_t m_size = 0;
+};
+
+} // namespace mcfp::detail
@@ -27,9 +27,24 @@
 #pragma once
 
 #include <cassert>
+#include <cstring>
+
+#include <algorithm>
 #include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#if __has_include(<span>)
+#include <span>
+#endif
+
+#include <mcfp/error.hpp>
 
 namespace mcfp::detail
 {
@@ -74,6 +89,12 @@ struct is_container_type<T,
 template <typename T>
 inline constexpr bool is_container_type_v = is_container_type<T>::value;
 
+template <typename T>
+using equality_t = decltype(std::declval<const T &>() == std::declval<const T &>());
+
+template <typename T>
+inline constexpr bool is_equality_comparable_v = is_detected_v<equality_t, T>;
+
 
 // --------------------------------------------------------------------
 // The options classes
@@ -141,23 +162,46 @@ struct option_traits<T, typename std::enable_if_t<not std::is_arithmetic_v<T> an
 	}
 };
 
+// Copy \a text into memory allocated from \a resource, empty text results
+// in an empty view with a nullptr data member
+
+inline std::string_view copy_text(std::string_view text, std::pmr::memory_resource &resource)
+{
+	if (text.empty())
+		return {};
+
+	auto data = static_cast<char *>(resource.allocate(text.length(), 1));
+	std::copy(text.begin(), text.end(), data);
+	return { data, text.length() };
+}
+
 // The Options. The reason to have this weird constructing of
 // polymorphic options based on templates is to have a very
 // simple interface. The disadvantage is that the options have
 // to be copied during the construction of the config object.
+//
+// The name and description are views. They refer to the text
+// passed to make_option until the config object copies them
+// into its own storage in init.
 
 struct option_base
 {
-	std::string m_name;        ///< The long argument name
-	std::string m_desc;        ///< The description of the argument
+	std::string_view m_name;   ///< The long argument name
+	std::string_view m_desc;   ///< The description of the argument
 	char m_short_name;         ///< The single character name of the argument, can be zero
 	bool m_is_flag = true,     ///< When true, this option does not allow arguments
 		m_has_default = false, ///< When true, this option has a default value.
 		m_multi = false,       ///< When true, this option allows mulitple values.
-		m_hidden;              ///< When true, this option is hidden from the help text
+		m_hidden,              ///< When true, this option is hidden from the help text
+		m_static_text = false, ///< When true, name and description refer to static text and are not copied
+		m_on_command_line = false; ///< When true, this option was specified on the command line or in the environment
 	int m_seen = 0;            ///< How often the option was seen on the command line
+	size_t m_reserve = 0;      ///< The number of values counted in a first pass over argv, only used while parsing
+	const std::type_info *m_type = nullptr; ///< The type of the stored value, nullptr for flags
+	std::string_view m_arg;    ///< The last argument, unconverted. A view on argv or on text kept by the config
 
 	option_base(const option_base &rhs) = default;
+	option_base &operator=(const option_base &rhs) = default;
 
 	option_base(std::string_view name, std::string_view desc, bool hidden)
 		: m_name(name)
@@ -170,20 +214,132 @@ struct option_base
 		else if (m_name.length() > 2 and m_name[m_name.length() - 2] == ',')
 		{
 			m_short_name = m_name.back();
-			m_name.erase(m_name.end() - 2, m_name.end());
+			m_name.remove_suffix(2);
 		}
 	}
 
 	virtual ~option_base() = default;
 
+	// Return a copy of this option, of the same derived type
+	virtual std::unique_ptr<option_base> clone() const = 0;
+
+	// Copy the state of \a rhs, which must be of the same derived type
+	virtual void assign(const option_base &rhs) = 0;
+
+	// Add the state of \a rhs, which must be of the same derived type, as
+	// if the arguments of rhs were specified after those of this option.
+	// A value in rhs replaces the value of a single valued option.
+	virtual void merge(const option_base &rhs)
+	{
+		m_seen += rhs.m_seen;
+	}
+
+	// Return to the state before any value was assigned
+	virtual void reset()
+	{
+		m_seen = 0;
+		m_arg = {};
+		m_on_command_line = false;
+	}
+
 	virtual void set_value(std::string_view /*value*/, std::error_code & /*ec*/)
 	{
 		assert(false);
 	}
 
-	virtual std::any get_value() const
+	// Make room for \a count more values, for options that can be repeated
+	virtual void reserve(size_t /*count*/)
 	{
-		return {};
+	}
+
+	// Return a pointer to the value, or nullptr if no value was assigned.
+	// The type of the value is described by m_type
+	virtual const void *get_value() const
+	{
+		return nullptr;
+	}
+
+	// Return a pointer to the member holding the value, the type of
+	// that member depends on the derived class
+	virtual const void *get_storage() const
+	{
+		return nullptr;
+	}
+
+	// Return the last argument as it was specified, without conversion.
+	// Returns an empty view with a nullptr data member if there is none.
+	virtual std::string_view get_argument() const
+	{
+		return m_arg;
+	}
+
+	// Append the binary representation of value number \a index to \a out,
+	// for the config cache. Only supported for arithmetic types, for other
+	// types nothing is appended.
+	virtual void append_binary_value(size_t /*index*/, std::string & /*out*/) const
+	{
+	}
+
+	// Set a value from the binary representation written by append_binary_value.
+	// Returns false if that is not supported, in that case the value should
+	// be set using set_value instead.
+	virtual bool set_binary_value(std::string_view /*argument*/, std::string_view /*binary*/)
+	{
+		return false;
+	}
+
+	// Return true if the converted value equals that of \a rhs, which must be
+	// of the same derived type. False if the values can not be compared.
+	virtual bool same_value(const option_base & /*rhs*/) const
+	{
+		return false;
+	}
+
+	// Return true if the unconverted arguments are equal to \a args
+	virtual bool same_arguments(const std::vector<std::string_view> &args) const
+	{
+		if (m_arg.data() == nullptr)
+			return args.empty();
+		return args.size() == 1 and args.front() == m_arg;
+	}
+
+	// Copy the unconverted arguments into memory from \a resource, so
+	// this option no longer refers to argv or to text of another config
+	virtual void copy_arguments(std::pmr::memory_resource &resource)
+	{
+		m_arg = copy_text(m_arg, resource);
+	}
+
+#if __cpp_lib_span >= 202002L
+	// Return all arguments as they were specified
+	virtual std::span<const std::string_view> get_arguments() const
+	{
+		if (m_arg.data() == nullptr)
+			return {};
+		return { &m_arg, 1 };
+	}
+#endif
+
+	// Return a pointer to the value if it was assigned and its type is T.
+	// Otherwise nullptr is returned and the reason is stored in ec.
+	template <typename T>
+	const T *get_value(std::error_code &ec) const
+	{
+		const void *value = get_value();
+
+		if (value == nullptr)
+		{
+			ec = make_error_code(config_error::option_not_specified);
+			return nullptr;
+		}
+
+		if (*m_type != typeid(T))
+		{
+			ec = make_error_code(config_error::wrong_type_cast);
+			return nullptr;
+		}
+
+		return static_cast<const T *>(value);
 	}
 
 	virtual std::string get_default_value() const
@@ -265,33 +421,114 @@ struct option : public option_base
 	using value_type = typename option_traits<T>::value_type;
 
 	std::optional<value_type> m_value;
+	std::optional<value_type> m_default;
 
 	option(const option &rhs) = default;
+	option &operator=(const option &rhs) = default;
 
 	option(std::string_view name, std::string_view desc, bool hidden)
 		: option_base(name, desc, hidden)
 	{
 		m_is_flag = false;
+		m_type = &typeid(value_type);
 	}
 
 	option(std::string_view name, const value_type &default_value, std::string_view desc, bool hidden)
 		: option(name, desc, hidden)
 	{
 		m_has_default = true;
-		m_value = default_value;
+		m_value = m_default = default_value;
+	}
+
+	std::unique_ptr<option_base> clone() const override
+	{
+		return std::make_unique<option>(*this);
+	}
+
+	void assign(const option_base &rhs) override
+	{
+		*this = static_cast<const option &>(rhs);
+	}
+
+	void merge(const option_base &rhs) override
+	{
+		// A value in rhs replaces this one, and so does its count
+		auto &opt = static_cast<const option &>(rhs);
+		if (opt.m_arg.data() != nullptr)
+		{
+			m_seen = opt.m_seen;
+			m_arg = opt.m_arg;
+			m_value = opt.m_value;
+		}
+		else
+			option_base::merge(rhs);
+	}
+
+	void reset() override
+	{
+		option_base::reset();
+		m_value = m_default;
 	}
 
 	void set_value(std::string_view argument, std::error_code &ec) override
 	{
+		m_arg = argument;
 		m_value = traits_type::set_value(argument, ec);
 	}
 
-	std::any get_value() const override
+	void append_binary_value(size_t /*index*/, std::string &out) const override
+	{
+		if constexpr (std::is_arithmetic_v<value_type>)
+		{
+			if (m_value)
+				out.append(reinterpret_cast<const char *>(&*m_value), sizeof(value_type));
+		}
+	}
+
+	bool set_binary_value(std::string_view argument, std::string_view binary) override
+	{
+		if constexpr (std::is_arithmetic_v<value_type>)
+		{
+			if (binary.length() == sizeof(value_type))
+			{
+				value_type value;
+				std::memcpy(&value, binary.data(), sizeof(value_type));
+				m_arg = argument;
+				m_value = value;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool same_value(const option_base &rhs) const override
+	{
+		if constexpr (is_equality_comparable_v<value_type>)
+			return m_value == static_cast<const option &>(rhs).m_value;
+		else
+			return false;
+	}
+
+	std::string_view get_argument() const override
+	{
+		if constexpr (std::is_same_v<value_type, std::string>)
+		{
+			if (m_arg.data() == nullptr and m_value)
+				return *m_value;
+		}
+
+		return m_arg;
+	}
+
+	const void *get_value() const override
+	{
+		return m_value ? &*m_value : nullptr;
+	}
+
+	const void *get_storage() const override
 	{
-		std::any result;
-		if (m_value)
-			result = *m_value;
-		return result;
+		return &m_value;
 	}
 
 	std::string get_default_value() const override
@@ -312,22 +549,128 @@ struct multiple_option : public option_base
 	std::vector<value_type> m_values;
 
 	multiple_option(const multiple_option &rhs) = default;
+	multiple_option &operator=(const multiple_option &rhs) = default;
 
 	multiple_option(std::string_view name, std::string_view desc, bool hidden)
 		: option_base(name, desc, hidden)
 	{
 		m_is_flag = false;
 		m_multi = true;
+		m_type = &typeid(std::vector<value_type>);
+	}
+
+	std::unique_ptr<option_base> clone() const override
+	{
+		return std::make_unique<multiple_option>(*this);
+	}
+
+	void assign(const option_base &rhs) override
+	{
+		*this = static_cast<const multiple_option &>(rhs);
+	}
+
+	void merge(const option_base &rhs) override
+	{
+		option_base::merge(rhs);
+
+		auto &opt = static_cast<const multiple_option &>(rhs);
+		m_values.insert(m_values.end(), opt.m_values.begin(), opt.m_values.end());
+		m_args.insert(m_args.end(), opt.m_args.begin(), opt.m_args.end());
+		if (not m_args.empty())
+			m_arg = m_args.back();
+	}
+
+	void reset() override
+	{
+		option_base::reset();
+		m_values.clear();
+		m_args.clear();
+	}
+
+	std::vector<std::string_view> m_args;
+
+	// Reserve only when needed and then at least twice the capacity, so
+	// that parsing again and again does not copy the values each time
+	void reserve(size_t count) override
+	{
+		size_t size = m_args.size() + count;
+		if (size > m_args.capacity())
+			m_args.reserve(std::max(size, 2 * m_args.capacity()));
+
+		size = m_values.size() + count;
+		if (size > m_values.capacity())
+			m_values.reserve(std::max(size, 2 * m_values.capacity()));
 	}
 
 	void set_value(std::string_view argument, std::error_code &ec) override
 	{
+		m_arg = argument;
+		m_args.emplace_back(argument);
 		m_values.emplace_back(traits_type::set_value(argument, ec));
 	}
 
-	std::any get_value() const override
+	void append_binary_value(size_t index, std::string &out) const override
+	{
+		if constexpr (std::is_arithmetic_v<value_type>)
+		{
+			if (index < m_values.size())
+				out.append(reinterpret_cast<const char *>(&m_values[index]), sizeof(value_type));
+		}
+	}
+
+	bool set_binary_value(std::string_view argument, std::string_view binary) override
+	{
+		if constexpr (std::is_arithmetic_v<value_type>)
+		{
+			if (binary.length() == sizeof(value_type))
+			{
+				value_type value;
+				std::memcpy(&value, binary.data(), sizeof(value_type));
+				m_arg = argument;
+				m_args.emplace_back(argument);
+				m_values.emplace_back(value);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool same_arguments(const std::vector<std::string_view> &args) const override
 	{
-		return { m_values };
+		return m_args == args;
+	}
+
+	bool same_value(const option_base &rhs) const override
+	{
+		if constexpr (is_equality_comparable_v<value_type>)
+			return m_values == static_cast<const multiple_option &>(rhs).m_values;
+		else
+			return false;
+	}
+
+	void copy_arguments(std::pmr::memory_resource &resource) override
+	{
+		for (auto &arg : m_args)
+			arg = copy_text(arg, resource);
+		m_arg = m_args.empty() ? std::string_view{} : m_args.back();
+	}
+
+#if __cpp_lib_span >= 202002L
+	std::span<const std::string_view> get_arguments() const override
+	{
+		return m_args;
+	}
+#endif
+
+	const void *get_value() const override
+	{
+		return &m_values;
+	}
+
+	const void *get_storage() const override
+	{
+		return &m_values;
 	}
 };
 
@@ -335,11 +678,98 @@ template <>
 struct option<void> : public option_base
 {
 	option(const option &rhs) = default;
+	option &operator=(const option &rhs) = default;
 
 	option(std::string_view name, std::string_view desc, bool hidden)
 		: option_base(name, desc, hidden)
 	{
 	}
+
+	std::unique_ptr<option_base> clone() const override
+	{
+		return std::make_unique<option>(*this);
+	}
+
+	void assign(const option_base &rhs) override
+	{
+		*this = static_cast<const option &>(rhs);
+	}
 };
 
+#if __cpp_nontype_template_args >= 201911L
+
+// --------------------------------------------------------------------
+// Options with a name that is known at compile time. The name is passed
+// as a string literal template argument, using the fixed_string class
+// below. This allows typed_config to resolve a name to an option at
+// compile time.
+
+template <size_t N>
+struct fixed_string
+{
+	constexpr fixed_string(const char (&s)[N])
+	{
+		for (size_t i = 0; i < N; ++i)
+			m_data[i] = s[i];
+	}
+
+	constexpr std::string_view view() const
+	{
+		return { m_data, N - 1 };
+	}
+
+	// The name without the optional trailing comma and short name
+	constexpr std::string_view long_name() const
+	{
+		auto name = view();
+		if (name.length() > 2 and name[name.length() - 2] == ',')
+			name.remove_suffix(2);
+		return name;
+	}
+
+	char m_data[N]{};
+};
+
+template <fixed_string Name, typename Base>
+struct named_option : public Base
+{
+	static constexpr std::string_view s_name = Name.long_name();
+
+	named_option(const named_option &rhs) = default;
+
+	template <typename... Args>
+		requires std::is_constructible_v<Base, std::string_view, Args...>
+	named_option(Args &&...args)
+		: Base(Name.view(), std::forward<Args>(args)...)
+	{
+	}
+};
+
+template <typename T>
+using static_name_t = decltype(T::s_name);
+
+template <typename T>
+using value_member_t = decltype(std::declval<T &>().m_value);
+
+template <typename T>
+using values_member_t = decltype(std::declval<T &>().m_values);
+
+template <typename T>
+inline constexpr bool is_multiple_option_v = is_detected_v<values_member_t, T>;
+
+template <typename T>
+inline constexpr bool is_flag_option_v = not is_detected_v<value_member_t, T> and not is_multiple_option_v<T>;
+
+// The compile time name of an option, or an empty string
+template <typename T>
+constexpr std::string_view static_name()
+{
+	if constexpr (is_detected_v<static_name_t, T>)
+		return T::s_name;
+	else
+		return {};
+}
+
+#endif
+
 } // namespace mcfp::detail
\ No newline at end of file
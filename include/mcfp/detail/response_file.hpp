@@ -0,0 +1,187 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstring>
+
+#include <array>
+#include <string_view>
+#include <system_error>
+
+#include <mcfp/error.hpp>
+#include <mcfp/detail/scan.hpp>
+
+namespace mcfp::detail
+{
+
+// --------------------------------------------------------------------
+// Split the contents of a response file, \a size bytes at \a data, into
+// arguments the way a POSIX shell splits words. Arguments are separated
+// by white space. Text between single quotes is taken literally, between
+// double quotes a backslash only escapes a double quote, a backslash, a
+// dollar sign, a back quote or an end of line. Elsewhere a backslash
+// escapes any character. A backslash followed by an end of line joins
+// lines. Adjacent quoted and unquoted parts form a single argument.
+//
+// The quotes and backslashes are removed in place, so each argument is
+// a view on \a data. Characters are only written when an argument
+// contained quotes or backslashes, for a file mapped copy-on-write only
+// the pages containing these are copied.
+//
+// For each argument \a handler is called with the argument and \a ec,
+// splitting stops when \a ec is set. An unterminated quote or a trailing
+// backslash is reported as config_error::invalid_response_file.
+
+template <typename Handler>
+void split_response_file(char *data, size_t size, Handler &&handler, std::error_code &ec)
+{
+	char *p = data;
+	char *const end = data + size;
+
+	auto is_separator = [](char ch)
+	{
+		return is_space(ch) or is_eoln(ch) or ch == '\v' or ch == '\f';
+	};
+
+	// The characters ending a run of plain characters, looked up in a table
+	static const auto kSpecial = []()
+	{
+		std::array<bool, 256> table{};
+		for (unsigned char ch : { ' ', '\t', '\n', '\r', '\v', '\f', '\'', '"', '\\' })
+			table[ch] = true;
+		return table;
+	}();
+
+	auto is_special = [](char ch)
+	{
+		return kSpecial[static_cast<unsigned char>(ch)];
+	};
+
+	while (not ec)
+	{
+		while (p != end and is_separator(*p))
+			++p;
+
+		if (p == end)
+			break;
+
+		char *const arg = p;
+		char *out = p;
+
+		// Move the characters from p up to \a to to out, unless they are
+		// already there, which is the case until the first quote or backslash
+		auto copy = [&p, &out](char *to)
+		{
+			if (out != p)
+				std::memmove(out, p, to - p);
+			out += to - p;
+			p = to;
+		};
+
+		// Skip an escaped end of line, a CR LF pair counts as one
+		auto skip_eoln = [&p, end]()
+		{
+			if (*p++ == '\r' and p != end and *p == '\n')
+				++p;
+		};
+
+		while (not ec)
+		{
+			char *q = p;
+			while (q != end and not is_special(*q))
+				++q;
+			copy(q);
+
+			if (p == end or is_separator(*p))
+				break;
+
+			if (*p == '\'')
+			{
+				++p;
+				q = static_cast<char *>(std::memchr(p, '\'', end - p));
+				if (q == nullptr)
+				{
+					ec = make_error_code(config_error::invalid_response_file);
+					break;
+				}
+
+				copy(q);
+				++p;
+			}
+			else if (*p == '"')
+			{
+				++p;
+				for (;;)
+				{
+					q = p;
+					while (q != end and *q != '"' and *q != '\\')
+						++q;
+					copy(q);
+
+					if (p != end and *p == '"')
+					{
+						++p;
+						break;
+					}
+
+					// an unterminated quote, possibly ending in a backslash
+					if (p == end or p + 1 == end)
+					{
+						ec = make_error_code(config_error::invalid_response_file);
+						break;
+					}
+
+					if (is_eoln(p[1]))
+					{
+						++p;
+						skip_eoln();
+						continue;
+					}
+
+					if (p[1] == '"' or p[1] == '\\' or p[1] == '$' or p[1] == '`')
+						++p;
+					copy(p + 1);
+				}
+			}
+			else // a backslash
+			{
+				++p;
+				if (p == end)
+					ec = make_error_code(config_error::invalid_response_file);
+				else if (is_eoln(*p))
+					skip_eoln();
+				else
+					copy(p + 1);
+			}
+		}
+
+		if (not ec)
+			handler(std::string_view(arg, out - arg), ec);
+	}
+}
+
+} // namespace mcfp::detail
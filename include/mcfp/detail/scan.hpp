@@ -0,0 +1,258 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__SSE2__) or defined(_M_X64) or (defined(_M_IX86_FP) and _M_IX86_FP >= 2)
+#define MCFP_HAS_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) and not defined(__INTEL_COMPILER)
+#define MCFP_HAS_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace mcfp::detail
+{
+
+// --------------------------------------------------------------------
+// Routines to scan the text of config files. Each of these returns a
+// pointer to the first character in [p, end) that does not belong to
+// the run that is skipped, or end.
+//
+// Besides the portable scalar versions there are SSE2 and AVX2 versions
+// that look at 16 or 32 characters at a time. The best version available
+// on the current CPU is selected once, at runtime.
+
+// Is \a ch a character that may be part of an option name
+constexpr bool is_name_char(char ch)
+{
+	return (ch >= 'a' and ch <= 'z') or (ch >= 'A' and ch <= 'Z') or (ch >= '0' and ch <= '9') or
+	       ch == '_' or ch == '-';
+}
+
+constexpr bool is_eoln(char ch)
+{
+	return ch == '\n' or ch == '\r';
+}
+
+constexpr bool is_space(char ch)
+{
+	return ch == ' ' or ch == '\t';
+}
+
+inline unsigned count_trailing_zeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long ix;
+	_BitScanForward(&ix, mask);
+	return ix;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// --------------------------------------------------------------------
+// Scalar versions
+
+inline const char *skip_line_scalar(const char *p, const char *end)
+{
+	while (p != end and not is_eoln(*p))
+		++p;
+	return p;
+}
+
+inline const char *skip_name_scalar(const char *p, const char *end)
+{
+	while (p != end and is_name_char(*p))
+		++p;
+	return p;
+}
+
+inline const char *skip_space_scalar(const char *p, const char *end)
+{
+	while (p != end and is_space(*p))
+		++p;
+	return p;
+}
+
+#if MCFP_HAS_SSE2
+// --------------------------------------------------------------------
+// SSE2, available on all x86-64 CPUs. The masks have a bit set for each
+// character that ends the run.
+
+inline uint32_t eoln_mask_sse2(__m128i v)
+{
+	auto m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+	return static_cast<uint32_t>(_mm_movemask_epi8(m));
+}
+
+inline uint32_t name_mask_sse2(__m128i v)
+{
+	// Characters with the high bit set are negative and thus outside all ranges
+	auto lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+	auto alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+	auto digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+	auto other = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+	auto name = _mm_or_si128(_mm_or_si128(alpha, digit), other);
+	return ~static_cast<uint32_t>(_mm_movemask_epi8(name)) & 0xffff;
+}
+
+inline uint32_t space_mask_sse2(__m128i v)
+{
+	auto m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+	return ~static_cast<uint32_t>(_mm_movemask_epi8(m)) & 0xffff;
+}
+
+template <uint32_t (*Mask)(__m128i), const char *(*Scalar)(const char *, const char *)>
+const char *scan_sse2(const char *p, const char *end)
+{
+	while (end - p >= 16)
+	{
+		uint32_t mask = Mask(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+		if (mask != 0)
+			return p + count_trailing_zeros(mask);
+		p += 16;
+	}
+
+	return Scalar(p, end);
+}
+
+inline const char *skip_line_sse2(const char *p, const char *end)
+{
+	return scan_sse2<eoln_mask_sse2, skip_line_scalar>(p, end);
+}
+
+inline const char *skip_name_sse2(const char *p, const char *end)
+{
+	return scan_sse2<name_mask_sse2, skip_name_scalar>(p, end);
+}
+
+inline const char *skip_space_sse2(const char *p, const char *end)
+{
+	return scan_sse2<space_mask_sse2, skip_space_scalar>(p, end);
+}
+#endif
+
+#if MCFP_HAS_AVX2
+// --------------------------------------------------------------------
+// AVX2, only used when the CPU supports it
+
+__attribute__((target("avx2"))) inline uint32_t eoln_mask_avx2(__m256i v)
+{
+	auto m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+	return static_cast<uint32_t>(_mm256_movemask_epi8(m));
+}
+
+__attribute__((target("avx2"))) inline uint32_t name_mask_avx2(__m256i v)
+{
+	auto lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+	auto alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+	auto digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+	auto other = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+	auto name = _mm256_or_si256(_mm256_or_si256(alpha, digit), other);
+	return ~static_cast<uint32_t>(_mm256_movemask_epi8(name));
+}
+
+__attribute__((target("avx2"))) inline uint32_t space_mask_avx2(__m256i v)
+{
+	auto m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+	return ~static_cast<uint32_t>(_mm256_movemask_epi8(m));
+}
+
+template <uint32_t (*Mask)(__m256i), const char *(*SSE2)(const char *, const char *)>
+__attribute__((target("avx2"))) const char *scan_avx2(const char *p, const char *end)
+{
+	while (end - p >= 32)
+	{
+		uint32_t mask = Mask(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+		if (mask != 0)
+			return p + count_trailing_zeros(mask);
+		p += 32;
+	}
+
+	return SSE2(p, end);
+}
+
+__attribute__((target("avx2"))) inline const char *skip_line_avx2(const char *p, const char *end)
+{
+	return scan_avx2<eoln_mask_avx2, skip_line_sse2>(p, end);
+}
+
+__attribute__((target("avx2"))) inline const char *skip_name_avx2(const char *p, const char *end)
+{
+	return scan_avx2<name_mask_avx2, skip_name_sse2>(p, end);
+}
+
+__attribute__((target("avx2"))) inline const char *skip_space_avx2(const char *p, const char *end)
+{
+	return scan_avx2<space_mask_avx2, skip_space_sse2>(p, end);
+}
+#endif
+
+// --------------------------------------------------------------------
+// The set of scan routines to use
+
+struct scanner
+{
+	using scan_func = const char *(*)(const char *, const char *);
+
+	scan_func skip_line;
+	scan_func skip_name;
+	scan_func skip_space;
+
+	static constexpr scanner scalar()
+	{
+		return { skip_line_scalar, skip_name_scalar, skip_space_scalar };
+	}
+
+	// The best scanner for this CPU, selected the first time this is called
+	static const scanner &best()
+	{
+		static const scanner s_best = []() {
+#if MCFP_HAS_AVX2
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2"))
+				return scanner{ skip_line_avx2, skip_name_avx2, skip_space_avx2 };
+#endif
+#if MCFP_HAS_SSE2
+			return scanner{ skip_line_sse2, skip_name_sse2, skip_space_sse2 };
+#else
+			return scalar();
+#endif
+		}();
+
+		return s_best;
+	}
+};
+
+} // namespace mcfp::detail
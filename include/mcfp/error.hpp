@@ -55,7 +55,10 @@ enum class config_error
 	option_not_specified,            /**< There was not option found on the command line and no default argument was specified for the option passed in @ref mcfp::config::get */
 	invalid_config_file,             /**< The config file is not of the expected format */
 	wrong_type_cast,                 /**< An attempt was made to ask for an option in another type than used when registering this option in @ref mcfp::config::init */
-	config_file_not_found            /**< The specified config file was not found */
+	config_file_not_found,           /**< The specified config file was not found */
+	include_cycle,                   /**< A config file includes itself, directly or indirectly */
+	include_depth_exceeded,          /**< Config file include directives were nested too deeply */
+	invalid_response_file            /**< A response file contains an unterminated quote or a trailing backslash */
 };
 /**
  * @brief The implementation for @ref config_category error messages
@@ -100,6 +103,12 @@ class config_category_impl : public std::error_category
 				return "the implementation contains a type cast error";
 			case config_error::config_file_not_found:
 				return "the specified config file was not found";
+			case config_error::include_cycle:
+				return "config file include directives form a cycle";
+			case config_error::include_depth_exceeded:
+				return "config file include directives are nested too deeply";
+			case config_error::invalid_response_file:
+				return "response file contains an unterminated quote or a trailing backslash";
 			default:
 				assert(false);
 				return "unknown error code";
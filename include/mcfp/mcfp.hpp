@@ -28,35 +28,200 @@
 
 /// \file
 /// This header-only library contains code to parse argc/argv and store the
-/// values provided into a singleton object.
+/// values provided into a config object, usually a singleton.
 
 #include <cassert>
 #include <cstring>
 
 #include <algorithm>
-#include <any>
+#include <array>
+#include <atomic>
 #include <charconv>
-#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
+#include <random>
+#include <thread>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <mcfp/error.hpp>
 #include <mcfp/text.hpp>
 #include <mcfp/utilities.hpp>
+#include <mcfp/detail/config_cache.hpp>
+#include <mcfp/detail/config_file.hpp>
+#include <mcfp/detail/environment.hpp>
+#include <mcfp/detail/mapped_file.hpp>
+#include <mcfp/detail/name_index.hpp>
 #include <mcfp/detail/options.hpp>
+#include <mcfp/detail/response_file.hpp>
 
 namespace mcfp
 {
 
 // --------------------------------------------------------------------
 /**
- * @brief A singleton class. Use @ref mcfp::config::instance to create and/or
- * retrieve the single instance
+ * @brief A typed handle to the value of an option. Use @ref mcfp::config::get_ref
+ * to obtain one.
+ *
+ * The option is looked up and its type is checked only once, when the handle
+ * is created. Reading the value through the handle accesses the stored value
+ * directly, making it suitable for use in tight loops.
+ *
+ * A handle is invalidated when @ref mcfp::config::init is called again.
+ *
+ * @tparam T The type of the value, this must be the value type of the option
+ * as registered in @ref mcfp::config::init
+ */
+
+template <typename T>
+class option_ref
+{
+	static constexpr bool is_multi = detail::is_container_type_v<T>;
+
+	using storage_type = std::conditional_t<is_multi, T, std::optional<T>>;
+
+  public:
+	/// @brief The type of the value
+	using value_type = T;
+
+	option_ref() = default;
+
+	/**
+	 * @brief Return true if the option has a value assigned
+	 */
+	bool has() const
+	{
+		return m_option != nullptr and (m_option->m_seen > 0 or m_option->m_has_default);
+	}
+
+	/**
+	 * @brief Return how often the option was seen
+	 */
+	int count() const
+	{
+		return m_option ? m_option->m_seen : 0;
+	}
+
+	/**
+	 * @brief Return the value of the option. Throws an exception if the
+	 * option has no value assigned.
+	 */
+	const T &get() const
+	{
+		if (m_storage == nullptr)
+			throw std::system_error(make_error_code(config_error::unknown_option));
+
+		if constexpr (is_multi)
+			return *m_storage;
+		else
+		{
+			if (not m_storage->has_value())
+				throw std::system_error(make_error_code(config_error::option_not_specified), std::string{ m_option->m_name });
+			return **m_storage;
+		}
+	}
+
+	/**
+	 * @brief Return the value of the option without checking whether
+	 * it was assigned
+	 */
+	const T &operator*() const
+	{
+		assert(m_storage != nullptr);
+
+		if constexpr (is_multi)
+			return *m_storage;
+		else
+		{
+			assert(m_storage->has_value());
+			return **m_storage;
+		}
+	}
+
+	/**
+	 * @brief Access the members of the value
+	 */
+	const T *operator->() const
+	{
+		return &**this;
+	}
+
+  private:
+	friend class config;
+
+	option_ref(const detail::option_base *option)
+		: m_option(option)
+		, m_storage(static_cast<const storage_type *>(option->get_storage()))
+	{
+	}
+
+	const detail::option_base *m_option = nullptr;
+	const storage_type *m_storage = nullptr;
+};
+
+// --------------------------------------------------------------------
+/**
+ * @brief A set of options assembled at runtime, for when the options are
+ * not known at compile time or when there are too many of them to pass
+ * to @ref mcfp::config::init as arguments.
+ * 
+ * @code{.cpp}
+ * mcfp::option_set options;
+ * for (auto &name : names)
+ * 	options.add(mcfp::make_option<int>(name, ""));
+ * 
+ * config.init("usage: example [options]", options);
+ * @endcode
+ * 
+ * The names and descriptions of the options are views, the text passed to
+ * mcfp::make_option must remain valid until the set is passed to init.
+ */
+
+class option_set
+{
+  public:
+	option_set() = default;
+
+	/**
+	 * @brief Add an option, use mcfp::make_option and variants to create it
+	 * 
+	 * @param option The option to add
+	 */
+	template <typename Option, std::enable_if_t<std::is_base_of_v<detail::option_base, Option>, int> = 0>
+	void add(Option option)
+	{
+		m_options.emplace_back(std::make_unique<Option>(std::move(option)));
+	}
+
+	/**
+	 * @brief Return the number of options in this set
+	 */
+	size_t size() const
+	{
+		return m_options.size();
+	}
+
+  private:
+	friend class config;
+
+	std::vector<std::unique_ptr<detail::option_base>> m_options;
+};
+
+// --------------------------------------------------------------------
+/**
+ * @brief The class containing the options and operands. Most programs use
+ * the global instance, use @ref mcfp::config::instance to create and/or
+ * retrieve it.
  * 
+ * Independent config objects can be created as well, each with their own
+ * set of options. These share no state, so separate objects can be
+ * initialised, parsed and read on separate threads concurrently.
  */
 
 class config
@@ -64,6 +229,25 @@ class config
 	using option_base = detail::option_base;
 
   public:
+	/**
+	 * @brief Construct a new, empty config object. Use @ref mcfp::config::init
+	 * to provide the set of options
+	 */
+	config() = default;
+
+	/**
+	 * @brief Construct a new, empty config object that allocates its storage
+	 * from \a resource, see @ref mcfp::config::set_memory_resource
+	 * 
+	 * @param resource The memory resource to use
+	 */
+	explicit config(std::pmr::memory_resource *resource)
+		: m_resource(resource)
+	{
+	}
+
+	config(const config &) = delete;
+	config &operator=(const config &) = delete;
 
 	/**
 	 * @brief Set the 'usage' string
@@ -78,15 +262,66 @@ class config
 	/**
 	 * @brief Initialise a config instance with a \a usage message and a set of \a options
 	 * 
+	 * The names and descriptions of the options are copied into the config object
+	 * here, the text passed to mcfp::make_option must remain valid until then.
+	 * 
+	 * The options of a @ref mcfp::typed_config are fixed, calling init on one,
+	 * also through a reference to config, throws a std::system_error.
+	 * 
 	 * @param usage The usage message
 	 * @param options Variadic list of options recognised by this config object, use mcfp::make_option and variants to create these
 	 */
 	template <typename... Options>
 	void init(std::string_view usage, Options... options)
 	{
+		check_options_not_fixed();
+
+		m_usage = usage;
+		m_ignore_unknown = false;
+		m_response_files = false;
+		m_config_file.clear();
+		m_included_files.clear();
+		m_impl.reset(new config_impl<Options...>(m_resource, std::forward<Options>(options)...));
+	}
+
+	/**
+	 * @brief Initialise a config instance with a \a usage message and a set of
+	 * \a options assembled at runtime. The options are copied, the set can
+	 * be used to initialise other config objects as well.
+	 * 
+	 * @param usage The usage message
+	 * @param options The options recognised by this config object
+	 */
+	void init(std::string_view usage, const option_set &options)
+	{
+		check_options_not_fixed();
+
+		std::vector<std::unique_ptr<option_base>> copies;
+		copies.reserve(options.size());
+		for (auto &opt : options.m_options)
+			copies.emplace_back(opt->clone());
+
 		m_usage = usage;
 		m_ignore_unknown = false;
-		m_impl.reset(new config_impl(std::forward<Options>(options)...));
+		m_response_files = false;
+		m_config_file.clear();
+		m_included_files.clear();
+		m_impl.reset(new config_dynamic_impl(m_resource, std::move(copies)));
+	}
+
+	/**
+	 * @brief Set the memory resource used for the storage of the config
+	 * object. The names and descriptions of the options, the text of config
+	 * files and other data kept by the config are allocated from a single
+	 * arena which in turn allocates large blocks from \a resource.
+	 * 
+	 * This takes effect at the next call to @ref mcfp::config::init
+	 * 
+	 * @param resource The memory resource to use
+	 */
+	void set_memory_resource(std::pmr::memory_resource *resource)
+	{
+		m_resource = resource;
 	}
 
 	/**
@@ -101,16 +336,26 @@ class config
 	}
 
 	/**
-	 * @brief Use this to retrieve the single instance of this class
+	 * @brief Set the response files flag, off by default
+	 * 
+	 * @param response_files When true, an argument `@file` passed to
+	 * @ref mcfp::config::parse is replaced by the arguments in file
+	 */
+	void set_response_files(bool response_files)
+	{
+		m_response_files = response_files;
+	}
+
+	/**
+	 * @brief Use this to retrieve the global instance of this class. Creating
+	 * this instance is thread safe.
 	 * 
-	 * @return config& The singleton instance
+	 * @return config& The global instance
 	 */
 	static config &instance()
 	{
-		static std::unique_ptr<config> s_instance;
-		if (not s_instance)
-			s_instance.reset(new config);
-		return *s_instance;
+		static config s_instance;
+		return s_instance;
 	}
 
 	/**
@@ -165,6 +410,14 @@ class config
 	 * the option has no value assigned or is of a wrong type,
 	 * ec is set to an appropriate error
 	 * 
+	 * Two types are treated specially. When \a T is std::string_view the
+	 * last argument for the option is returned as it was specified, without
+	 * conversion. When \a T is std::span<const std::string_view> all arguments
+	 * specified for the option are returned. These views point into argv or
+	 * into text kept by this config object, so nothing is copied. For options
+	 * with a std::string value, the std::string_view version falls back to
+	 * the default value.
+	 * 
 	 * @tparam T The type of the value requested.
 	 * @param name The name of the option requested
 	 * @param ec The error status is returned in this variable
@@ -176,29 +429,115 @@ class config
 		using return_type = std::remove_cv_t<T>;
 
 		return_type result{};
-		auto opt = m_impl->get_option(name);
 
-		if (opt == nullptr)
-			ec = make_error_code(config_error::unknown_option);
-		else
+		if constexpr (std::is_same_v<return_type, std::string_view>)
 		{
-			std::any value = opt->get_value();
-
-			if (not value.has_value())
+			if (auto opt = m_impl->get_option(name); opt == nullptr)
+				ec = make_error_code(config_error::unknown_option);
+			else if (result = opt->get_argument(); result.data() == nullptr)
 				ec = make_error_code(config_error::option_not_specified);
+		}
+#if __cpp_lib_span >= 202002L
+		else if constexpr (std::is_same_v<return_type, std::span<const std::string_view>>)
+		{
+			if (auto opt = m_impl->get_option(name); opt == nullptr)
+				ec = make_error_code(config_error::unknown_option);
 			else
-			{
-				try
-				{
-					result = std::any_cast<T>(value);
-				}
-				catch (const std::bad_cast &)
-				{
-					ec = make_error_code(config_error::wrong_type_cast);
-				}
-			}
+				result = opt->get_arguments();
+		}
+#endif
+		else if (auto value = get_if<T>(name, ec); value != nullptr)
+			result = *value;
+
+		return result;
+	}
+
+	/**
+	 * @brief Returns a pointer to the value for the option with name \a name
+	 * or nullptr if the option does not exist, has no value assigned or is
+	 * of a different type. The value is not copied.
+	 * 
+	 * @tparam T The type of the value requested.
+	 * @param name The name of the option requested
+	 * @return const T* Pointer to the value of the named option
+	 */
+	template <typename T>
+	const std::remove_cv_t<T> *get_if(std::string_view name) const
+	{
+		std::error_code ec;
+		return get_if<T>(name, ec);
+	}
+
+	/**
+	 * @brief Returns a pointer to the value for the option with name \a name.
+	 * If the option has no value assigned or is of a wrong type, nullptr is
+	 * returned and ec is set to an appropriate error. The value is not copied
+	 * and no exceptions are thrown.
+	 * 
+	 * @tparam T The type of the value requested.
+	 * @param name The name of the option requested
+	 * @param ec The error status is returned in this variable
+	 * @return const T* Pointer to the value of the named option
+	 */
+	template <typename T>
+	const std::remove_cv_t<T> *get_if(std::string_view name, std::error_code &ec) const
+	{
+		auto opt = m_impl->get_option(name);
+
+		if (opt == nullptr)
+		{
+			ec = make_error_code(config_error::unknown_option);
+			return nullptr;
 		}
 
+		return opt->get_value<std::remove_cv_t<T>>(ec);
+	}
+
+	/**
+	 * @brief Returns a typed handle to the option with name \a name. Throws
+	 * an exception if the option does not exist or if its type is not \a T
+	 * 
+	 * @tparam T The type of the value of the option
+	 * @param name The name of the option requested
+	 * @return option_ref<T> The handle to the named option
+	 */
+	template <typename T>
+	option_ref<std::remove_cv_t<T>> get_ref(std::string_view name) const
+	{
+		std::error_code ec;
+		auto result = get_ref<T>(name, ec);
+
+		if (ec)
+			throw std::system_error(ec, std::string{ name });
+
+		return result;
+	}
+
+	/**
+	 * @brief Returns a typed handle to the option with name \a name. If
+	 * the option does not exist or is of a wrong type, ec is set to an
+	 * appropriate error and an empty handle is returned.
+	 * 
+	 * @tparam T The type of the value of the option
+	 * @param name The name of the option requested
+	 * @param ec The error status is returned in this variable
+	 * @return option_ref<T> The handle to the named option
+	 */
+	template <typename T>
+	option_ref<std::remove_cv_t<T>> get_ref(std::string_view name, std::error_code &ec) const
+	{
+		using value_type = std::remove_cv_t<T>;
+
+		option_ref<value_type> result;
+		auto opt = m_impl->get_option(name);
+
+		if (opt == nullptr)
+			ec = make_error_code(config_error::unknown_option);
+		else if (opt->m_type == nullptr or *opt->m_type != typeid(value_type))
+			ec = make_error_code(config_error::wrong_type_cast);
+		else
+			result = option_ref<value_type>(opt);
+
 		return result;
 	}
 
@@ -235,10 +574,78 @@ class config
 	 * @return const std::vector<std::string>& The operand as a vector of strings
 	 */
 	const std::vector<std::string> &operands() const
+	{
+		return m_impl->operand_strings();
+	}
+
+	/**
+	 * @brief Return the list of operands as views on the argv passed to
+	 * @ref mcfp::config::parse, these are only valid as long as argv is.
+	 * The text of the operands is also copied into the storage of this
+	 * config object, the strings returned by @ref mcfp::config::operands
+	 * are created from that copy on first use.
+	 * 
+	 * @return const std::pmr::vector<std::string_view>& The operands
+	 */
+	const std::pmr::vector<std::string_view> &operands_view() const
 	{
 		return m_impl->m_operands;
 	}
 
+	/**
+	 * @brief Return an immutable copy of the current options, their values
+	 * and the operands. The copy does not refer to this config object, nor
+	 * to argv or config file text, and remains valid when this object is
+	 * modified, reinitialised or destroyed.
+	 * 
+	 * Since the copy is const, any number of threads can read it without
+	 * locking.
+	 * 
+	 * @return std::shared_ptr<const config> The snapshot
+	 */
+	std::shared_ptr<const config> freeze() const
+	{
+		return std::shared_ptr<const config>(new config(m_impl->clone(), m_usage));
+	}
+
+	/**
+	 * @brief Create a new snapshot using @ref mcfp::config::freeze and make
+	 * it the one returned by @ref mcfp::config::snapshot. The switch is
+	 * atomic, readers see either the previous or the new snapshot.
+	 * 
+	 * The intended use is a control thread that reparses the configuration,
+	 * e.g. after calling @ref mcfp::config::init again, and then publishes
+	 * the result, while worker threads only access the configuration
+	 * through @ref mcfp::config::snapshot.
+	 */
+	void publish()
+	{
+		auto snapshot = freeze();
+#if __cpp_lib_atomic_shared_ptr >= 201711L
+		m_snapshot.store(std::move(snapshot), std::memory_order_release);
+#else
+		std::atomic_store_explicit(&m_snapshot, std::move(snapshot), std::memory_order_release);
+#endif
+	}
+
+	/**
+	 * @brief Return the snapshot most recently published with
+	 * @ref mcfp::config::publish, or nullptr if none was published.
+	 * Calling this is safe while another thread publishes a new snapshot.
+	 * A snapshot remains valid for as long as a reference to it is held,
+	 * so keep it for a unit of work rather than calling this for each value.
+	 * 
+	 * @return std::shared_ptr<const config> The published snapshot
+	 */
+	std::shared_ptr<const config> snapshot() const
+	{
+#if __cpp_lib_atomic_shared_ptr >= 201711L
+		return m_snapshot.load(std::memory_order_acquire);
+#else
+		return std::atomic_load_explicit(&m_snapshot, std::memory_order_acquire);
+#endif
+	}
+
 	/**
 	 * @brief Write the configuration to the std::ostream \a os
 	 * This will print the usage string and each of the configured
@@ -326,13 +733,16 @@ class config
 
 		for (std::filesystem::path dir : search_dirs)
 		{
-			std::ifstream file(dir / file_name);
+			std::error_code open_ec;
+			detail::mapped_file file(dir / file_name, open_ec);
 
-			if (not file.is_open())
+			if (open_ec)
 				continue;
 
-			parse_config_file(file, ec);
+			config_text_context context(dir / file_name);
+			parse_config_text(file.text(), context, ec);
 			parsed_config_file = true;
+			set_config_file(dir / file_name, context);
 			break;
 		}
 
@@ -344,353 +754,1516 @@ class config
 	 * @brief Parse a configuration file specified by \a file
 	 * If an error is found it is returned in the variable \a ec
 	 * 
+	 * The file is mapped into memory, when possible, and parsed in place.
+	 * 
 	 * @param file The path to the config file
 	 * @param ec The variable containing the error status
 	 */
 	void parse_config_file(const std::filesystem::path &file, std::error_code &ec)
 	{
-		std::ifstream is(file);
-		if (is.is_open())
-			parse_config_file(is, ec);
-	}
-
-  private:
-
-	static bool is_name_char(int ch)
-	{
-		return std::isalnum(ch) or ch == '_' or ch == '-';
-	}
-
-	static constexpr bool is_eoln(int ch)
-	{
-		return ch == '\n' or ch == '\r' or ch == std::char_traits<char>::eof();
+		std::error_code open_ec;
+		detail::mapped_file mapped(file, open_ec);
+		if (not open_ec)
+		{
+			config_text_context context(file);
+			parse_config_text(mapped.text(), context, ec);
+			set_config_file(file, context);
+		}
 	}
 
-  public:
-
 	/**
-	 * @brief Parse the configuration file in \a is
-	 * If an error is found it is returned in the variable \a ec
+	 * @brief Parse a configuration file specified by \a file, using the
+	 * binary cache in \a cache_file when that is up to date. Returns true
+	 * if the cache was used. If an error is found it is returned in the
+	 * variable \a ec
 	 * 
-	 * @param is A std::istream for the contents of a config file
+	 * The cache contains the arguments found in the config file and, for
+	 * options with an arithmetic type, the converted values. Loading it
+	 * requires no text parsing and no conversion for these options. The
+	 * cache is considered out of date when the size, the modification time
+	 * or the hash of the contents of \a file differ from when it was
+	 * written, or when the options of this config object differ. The same
+	 * goes for each file included by \a file. In that
+	 * case \a file is parsed and a new cache is written. Failing to write
+	 * the cache is not an error.
+	 * 
+	 * Like with @ref mcfp::config::parse_config_file, a missing \a file is
+	 * not an error.
+	 * 
+	 * @param file The path to the config file
+	 * @param cache_file The path to the cache file
 	 * @param ec The variable containing the error status
+	 * @return bool True if the cache was used
 	 */
-	void parse_config_file(std::istream &is, std::error_code &ec)
+	bool parse_cached_config_file(const std::filesystem::path &file, const std::filesystem::path &cache_file, std::error_code &ec)
 	{
-		auto &buffer = *is.rdbuf();
+		std::error_code file_ec;
+		detail::mapped_file source(file, file_ec);
+		if (file_ec)
+			return false;
 
-		enum class State
-		{
-			NAME_START,
-			COMMENT,
-			NAME,
-			ASSIGN,
-			VALUE_START,
-			VALUE
-		} state = State::NAME_START;
+		m_config_file = file;
 
-		std::string name, value;
+		auto mtime = std::filesystem::last_write_time(file, file_ec);
 
-		for (;;)
-		{
-			auto ch = buffer.sbumpc();
+		const detail::config_cache_header header(
+			source.text().length(),
+			file_ec ? 0 : static_cast<int64_t>(mtime.time_since_epoch().count()),
+			detail::hash_bytes(source.text()),
+			schema_hash());
 
-			switch (state)
-			{
-				case State::NAME_START:
-					if (is_name_char(ch))
-					{
-						name = { static_cast<char>(ch) };
-						value.clear();
-						state = State::NAME;
-					}
-					else if (ch == '#' or ch == ';')
-						state = State::COMMENT;
-					else if (ch != ' ' and ch != '\t' and not is_eoln(ch))
-						ec = make_error_code(config_error::invalid_config_file);
-					break;
-
-				case State::COMMENT:
-					if (is_eoln(ch))
-						state = State::NAME_START;
-					break;
-
-				case State::NAME:
-					if (is_name_char(ch))
-						name.insert(name.end(), static_cast<char>(ch));
-					else if (is_eoln(ch))
-					{
-						auto opt = m_impl->get_option(name);
-
-						if (opt == nullptr)
-						{
-							if (not m_ignore_unknown)
-								ec = make_error_code(config_error::unknown_option);
-						}
-						else if (not opt->m_is_flag)
-							ec = make_error_code(config_error::missing_argument_for_option);
-						else
-							++opt->m_seen;
-
-						state = State::NAME_START;
-					}
-					else
-					{
-						buffer.sungetc();
-						state = State::ASSIGN;
-					}
-					break;
-
-				case State::ASSIGN:
-					if (ch == '=')
-						state = State::VALUE_START;
-					else if (is_eoln(ch))
-					{
-						auto opt = m_impl->get_option(name);
-
-						if (opt == nullptr)
-						{
-							if (not m_ignore_unknown)
-								ec = make_error_code(config_error::unknown_option);
-						}
-						else if (not opt->m_is_flag)
-							ec = make_error_code(config_error::missing_argument_for_option);
-						else
-							++opt->m_seen;
-
-						state = State::NAME_START;
-					}
-					else if (ch != ' ' and ch != '\t')
-						ec = make_error_code(config_error::invalid_config_file);
-					break;
-
-				case State::VALUE_START:
-				case State::VALUE:
-					if (is_eoln(ch))
-					{
-						auto opt = m_impl->get_option(name);
-
-						if (opt == nullptr)
-						{
-							if (not m_ignore_unknown)
-								ec = make_error_code(config_error::unknown_option);
-						}
-						else if (opt->m_is_flag)
-							ec = make_error_code(config_error::option_does_not_accept_argument);
-						else if (not value.empty() and (opt->m_seen == 0 or opt->m_multi))
-						{
-							opt->set_value(value, ec);
-							++opt->m_seen;
-						}
-
-						state = State::NAME_START;
-					}
-					else if (state == State::VALUE)
-						value.insert(value.end(), static_cast<char>(ch));
-					else if (ch != ' ' and ch != '\t')
-					{
-						value = { static_cast<char>(ch) };
-						state = State::VALUE;
-					}
-					break;
-			}
+		detail::mapped_file cache(cache_file, file_ec);
+		if (not file_ec and load_config_cache(cache.text(), header, ec))
+			return true;
 
-			if (ec or ch == std::char_traits<char>::eof())
-				break;
+		if (ec)
+			return false;
+
+		config_text_context context(file);
+		detail::config_cache_writer records;
+
+		build_config_cache(source.text(), context, records, ec);
+		if (ec)
+			return false;
+
+		// The included files follow the header, so that a change in
+		// any of them invalidates the cache as well
+		detail::config_cache_writer image;
+		image.write(header);
+		image.write(static_cast<uint32_t>(context.included.size()));
+		for (auto &included : context.included)
+		{
+			image.write(std::string_view(included->m_path.native()));
+			image.write(included->m_size);
+			image.write(included->m_mtime);
 		}
+		image.data() += records.data();
+
+		write_config_cache(cache_file, image.data());
+		load_config_cache(image.data(), header, ec, false);
+
+		return false;
 	}
 
 	/**
-	 * @brief Parse the \a argv vector containing \a argc elements.
-	 * In case of an error, the error is returned in \a ec
+	 * @brief Parse all files ending in .conf in directory \a dir, like
+	 * a conf.d directory. See the other version for details.
 	 * 
-	 * @param argc The number of elements in \a argv
-	 * @param argv The vector of command line arguments
-	 * @param ec The variable receiving the error status
+	 * @param dir The directory containing the config file fragments
+	 * @param ec The variable containing the error status
 	 */
-	void parse(int argc, const char *const argv[], std::error_code &ec)
+	void parse_config_directory(const std::filesystem::path &dir, std::error_code &ec)
 	{
-		using namespace std::literals;
+		parse_config_directory(dir, ".conf", 0, ec);
+	}
 
-		enum class State
+	/**
+	 * @brief Parse all files ending in \a extension in directory \a dir.
+	 * The files are parsed concurrently using \a thread_count threads and
+	 * the results are merged in lexical order of the file names. If an
+	 * error is found it is returned in the variable \a ec and no option
+	 * is changed.
+	 * 
+	 * The result of merging does not depend on the number of threads:
+	 * 
+	 * - For options with a single value, a value in a later file replaces
+	 *   the value of an earlier file. Within a file the first value counts,
+	 *   as with @ref mcfp::config::parse_config_text.
+	 * - Options that already had a value before this call, e.g. from the
+	 *   command line, keep that value.
+	 * - The values of options that can be repeated are appended, in the
+	 *   order of the files and in the order of the lines within a file.
+	 * - Flags are counted for each time they appear.
+	 * 
+	 * Files whose name starts with a dot are skipped. A missing directory
+	 * is not an error, a directory that cannot be read is.
+	 * 
+	 * @param dir The directory containing the config file fragments
+	 * @param extension The extension of the files to parse
+	 * @param thread_count The maximum number of threads to use, zero to use
+	 * one thread per available core
+	 * @param ec The variable containing the error status
+	 */
+	void parse_config_directory(const std::filesystem::path &dir, std::string_view extension,
+		size_t thread_count, std::error_code &ec)
+	{
+		std::vector<std::filesystem::path> files;
+
+		std::error_code dir_ec;
+		for (std::filesystem::directory_iterator i(dir, dir_ec), end; not dir_ec and i != end; i.increment(dir_ec))
+		{
+			auto name = i->path().filename().string();
+
+			if (name.front() == '.' or name.length() <= extension.length() or
+				std::string_view(name).substr(name.length() - extension.length()) != extension)
+				continue;
+
+			// An entry that can not be examined, e.g. a dangling
+			// symbolic link, is skipped
+			std::error_code entry_ec;
+			if (i->is_regular_file(entry_ec) and not entry_ec)
+				files.emplace_back(i->path());
+		}
+
+		if (dir_ec and dir_ec != std::errc::no_such_file_or_directory)
+		{
+			ec = dir_ec;
+			return;
+		}
+
+		std::sort(files.begin(), files.end());
+
+		// Parse each fragment and convert its values into copies of the
+		// options. This only reads the options of this config object.
+		struct fragment
+		{
+			detail::mapped_file file;
+			std::vector<std::pair<option_base *, std::unique_ptr<option_base>>> updates;
+			std::error_code ec;
+		};
+
+		std::vector<fragment> fragments(files.size());
+
+		auto parse_fragment = [this, &files, &fragments](size_t ix)
+		{
+			auto &f = fragments[ix];
+
+			f.file = detail::mapped_file(files[ix], f.ec);
+			if (f.ec)
+				return;
+
+			config_text_context context(files[ix]);
+			config_text_contents contents;
+			collect_config_text(f.file.text(), context, contents, f.ec);
+
+			for (auto &[opt, count] : contents.flags)
+			{
+				auto &update = f.updates.emplace_back(opt, opt->clone()).second;
+				update->reset();
+				update->m_seen = count;
+			}
+
+			for (auto &[opt, args] : contents.arguments)
+			{
+				if (args.empty())
+					continue;
+
+				auto &update = f.updates.emplace_back(opt, opt->clone()).second;
+				update->reset();
+
+				for (auto arg : args)
+				{
+					update->set_value(arg, f.ec);
+					++update->m_seen;
+				}
+			}
+		};
+
+		if (thread_count == 0)
+			thread_count = std::thread::hardware_concurrency();
+		thread_count = std::min(thread_count, files.size());
+
+		if (thread_count <= 1)
+		{
+			for (size_t ix = 0; ix < files.size(); ++ix)
+				parse_fragment(ix);
+		}
+		else
+		{
+			std::atomic<size_t> next = 0;
+			std::vector<std::thread> threads;
+
+			for (size_t t = 0; t < thread_count; ++t)
+			{
+				threads.emplace_back([&next, &files, &parse_fragment]()
+				{
+					for (size_t ix = next++; ix < files.size(); ix = next++)
+						parse_fragment(ix);
+				});
+			}
+
+			for (auto &t : threads)
+				t.join();
+		}
+
+		for (auto &f : fragments)
+		{
+			if (f.ec)
+			{
+				ec = f.ec;
+				return;
+			}
+		}
+
+		// Merge the fragments in lexical order
+		std::unordered_set<option_base *> keep;
+		for (auto opt : m_impl->m_option_list)
+		{
+			if (opt->m_seen > 0 and not opt->m_is_flag and not opt->m_multi)
+				keep.insert(opt);
+		}
+
+		for (auto &f : fragments)
+		{
+			for (auto &[opt, update] : f.updates)
+			{
+				if (keep.count(opt))
+					continue;
+
+				update->copy_arguments(m_impl->m_arena);
+				opt->merge(*update);
+			}
+		}
+	}
+
+	/**
+	 * @brief Return the path of the config file last read by one of the
+	 * parse_config_file versions that take a file name or by
+	 * reload_config_file, or an empty path if no config file was read.
+	 */
+	const std::filesystem::path &config_file() const
+	{
+		return m_config_file;
+	}
+
+	/**
+	 * @brief Return the canonical paths of the files included by the
+	 * config file returned by @ref mcfp::config::config_file, directly or
+	 * indirectly, when it was last read or reloaded.
+	 */
+	const std::vector<std::filesystem::path> &included_files() const
+	{
+		return m_included_files;
+	}
+
+	/**
+	 * @brief Parse the configuration file in \a is
+	 * If an error is found it is returned in the variable \a ec
+	 * 
+	 * @param is A std::istream for the contents of a config file
+	 * @param ec The variable containing the error status
+	 */
+	void parse_config_file(std::istream &is, std::error_code &ec)
+	{
+		auto &buffer = *is.rdbuf();
+
+		// Parse the stream in blocks, only a partial last line and
+		// the current section are kept between blocks
+		config_text_context context;
+		std::string partial;
+		char block[16 * 1024];
+
+		while (not ec)
+		{
+			auto n = buffer.sgetn(block, sizeof(block));
+			if (n <= 0)
+				break;
+
+			feed_config_text(context, partial, { block, static_cast<size_t>(n) }, ec);
+		}
+
+		if (not ec)
+			parse_config_text(partial, context, ec);
+	}
+
+	/**
+	 * @brief Parse the contents of a configuration file in \a text
+	 * If an error is found it is returned in the variable \a ec
+	 * 
+	 * Each line contains either a name and a value separated by an equals
+	 * character, the name of a flag, or a comment starting with a hash or
+	 * semicolon character. The values are copied, \a text need not remain
+	 * valid after this call.
+	 * 
+	 * A line `include = file` reads the lines of \a file at that point,
+	 * unless there is an option called include. A relative path is taken
+	 * relative to the directory of the including file, or to the current
+	 * directory for \a text itself. Included files are read and tokenized
+	 * only once for as long as they do not change. Include cycles and
+	 * includes nested more than 16 levels deep are reported as
+	 * config_error::include_cycle and config_error::include_depth_exceeded.
+	 * 
+	 * @param text The contents of a config file
+	 * @param ec The variable containing the error status
+	 */
+	void parse_config_text(std::string_view text, std::error_code &ec)
+	{
+		config_text_context context;
+		parse_config_text(text, context, ec);
+	}
+
+	/**
+	 * @brief Check the contents of a configuration file in \a text against
+	 * the options of this config object, without changing them. For each
+	 * error found \a report is called as `report(line, column, ec)`, with
+	 * the line and column, both starting at one, where the error was found.
+	 * A line ends with LF, CR LF or a lone CR. When \a report accepts a
+	 * fourth argument, it also receives the offset of the error in \a text.
+	 * Returns the number of errors.
+	 * 
+	 * Unlike @ref mcfp::config::parse_config_text, checking continues after
+	 * an error. After a syntax error that is at the next line. Values are
+	 * converted to check them, and the column of a conversion error is that
+	 * of the value. Include directives are not followed. This does not
+	 * modify the config object, several threads may check files at the
+	 * same time.
+	 * 
+	 * @param text The contents of a config file
+	 * @param report The callback receiving the errors
+	 * @return size_t The number of errors found
+	 */
+	template <typename Report>
+	size_t validate_config_text(std::string_view text, Report &&report) const
+	{
+		const char *const end = text.data() + text.length();
+
+		// Lines are counted up to the position of each error, in order
+		size_t errors = 0, line = 1;
+		const char *counted = text.data(), *line_start = text.data();
+
+		auto report_at = [&](const char *p, std::error_code ec)
+		{
+			for (; counted < p; ++counted)
+			{
+				if (*counted == '\n' or (*counted == '\r' and (counted + 1 == end or counted[1] != '\n')))
+				{
+					++line;
+					line_start = counted + 1;
+				}
+			}
+
+			++errors;
+			if constexpr (std::is_invocable_v<Report, size_t, size_t, std::error_code, size_t>)
+				report(line, static_cast<size_t>(p - line_start + 1), ec, static_cast<size_t>(p - text.data()));
+			else
+				report(line, static_cast<size_t>(p - line_start + 1), ec);
+		};
+
+		// The values are converted in copies of the options
+		std::unordered_map<option_base *, std::unique_ptr<option_base>> copies;
+
+		auto check = [&](const detail::config_section &section, std::string_view name, std::optional<std::string_view> value, std::error_code &)
+		{
+			if (is_include(section, name))
+				return;
+
+			auto opt = m_impl->get_option(section, name);
+
+			std::error_code ec;
+			const char *p = name.data();
+
+			if (opt == nullptr)
+			{
+				if (not m_ignore_unknown)
+					ec = make_error_code(config_error::unknown_option);
+			}
+			else if (not value.has_value())
+			{
+				if (not opt->m_is_flag)
+					ec = make_error_code(config_error::missing_argument_for_option);
+			}
+			else if (opt->m_is_flag)
+				ec = make_error_code(config_error::option_does_not_accept_argument);
+			else if (not value->empty())
+			{
+				auto &copy = copies[opt];
+				if (not copy)
+					copy = opt->clone();
+
+				copy->set_value(*value, ec);
+				p = value->data();
+			}
+
+			if (ec)
+				report_at(p, ec);
+		};
+
+		detail::config_section section;
+
+		for (;;)
+		{
+			std::error_code ec;
+			const char *p = text.data() + detail::tokenize_config_text(text, section, check, ec);
+
+			if (not ec)
+				break;
+
+			report_at(p, ec);
+
+			p = detail::scanner::best().skip_line(p, end);
+			text = std::string_view(p, end - p);
+		}
+
+		return errors;
+	}
+
+	/**
+	 * @brief Parse the \a argv vector containing \a argc elements.
+	 * In case of an error, the error is returned in \a ec
+	 * 
+	 * The options and operands refer to the text in \a argv, which must
+	 * remain valid for as long as this config object uses it. The text of
+	 * the operands is copied into the storage of this config object as well.
+	 * 
+	 * If all options given in \a argv are flags or have a single arithmetic
+	 * value, parsing allocates memory only from the memory resource of this
+	 * config object, see @ref mcfp::config::set_memory_resource. Using a
+	 * resource with a fixed buffer it then does no heap allocation at all.
+	 * Other options keep their values in their own type, e.g. a std::string
+	 * or the std::vector of an option that can be repeated, which do
+	 * allocate from the heap.
+	 * 
+	 * When response files are enabled with
+	 * @ref mcfp::config::set_response_files, an argument `@file`, where an
+	 * option or operand is expected, is replaced by the arguments in the
+	 * response file \a file. These are
+	 * separated by white space and may be quoted as in a POSIX shell. The
+	 * file is mapped into memory and the arguments refer to it, it is kept
+	 * open as long as this config object uses it. Response files can not
+	 * be nested. A missing response file is reported as
+	 * config_error::config_file_not_found.
+	 * 
+	 * Options that can be repeated are counted in a first pass over \a argv
+	 * and room for their values is reserved at once. The values of an option
+	 * given a million times in \a argv are thus stored without reallocation.
+	 * Arguments in response files and options in a cluster of short options,
+	 * other than the first, are not counted.
+	 * 
+	 * @param argc The number of elements in \a argv
+	 * @param argv The vector of command line arguments
+	 * @param ec The variable receiving the error status
+	 */
+	void parse(int argc, const char *const argv[], std::error_code &ec)
+	{
+		if (argc > 1)
+			m_impl->reserve_operands(argc - 1);
+
+		if (not m_impl->m_multi_options.empty())
+			reserve_multiple_values(argc, argv);
+
+		parse_state state;
+
+		for (int i = 1; i < argc and not ec; ++i)
+		{
+			if (argv[i] == nullptr) // should not happen
+				break;
+
+			std::string_view arg(argv[i]);
+
+			if (m_response_files and arg.length() > 1 and arg.front() == '@' and not state.operands and state.pending == nullptr)
+				parse_response_file(arg.substr(1), state, ec);
+			else
+				parse_argument(arg, state, ec);
+		}
+
+		// The last option did not get its argument
+		if (not ec and state.pending != nullptr)
+			ec = make_error_code(config_error::missing_argument_for_option);
+	}
+
+	/**
+	 * @brief Set options from the environment variables whose name starts
+	 * with \a prefix. Throws an exception in case of an error, see the
+	 * version with an error code argument for details.
+	 * 
+	 * @param prefix The prefix of the environment variables, e.g. MYTOOL_
+	 */
+	void parse_environment(std::string_view prefix)
+	{
+		std::error_code ec;
+		parse_environment(prefix, ec);
+		if (ec)
+			throw std::system_error(ec);
+	}
+
+	/**
+	 * @brief Set options from the environment variables of this process
+	 * whose name starts with \a prefix, see the version with an \a envp
+	 * argument. If an error is found it is returned in \a ec
+	 * 
+	 * @param prefix The prefix of the environment variables, e.g. MYTOOL_
+	 * @param ec The variable receiving the error status
+	 */
+	void parse_environment(std::string_view prefix, std::error_code &ec)
+	{
+		parse_environment(prefix, detail::environment(), ec);
+	}
+
+	/**
+	 * @brief Set options from the variables in \a envp whose name starts
+	 * with \a prefix. If an error is found it is returned in \a ec
+	 * 
+	 * The rest of the name of a variable is converted to the name of an
+	 * option: letters are lower cased and an underscore becomes a hyphen,
+	 * so that with prefix MYTOOL_ the variable MYTOOL_CACHE_SIZE sets option
+	 * cache-size. If there is no such option, the underscores are kept and
+	 * cache_size is tried. A double underscore separates a section from the
+	 * name, MYTOOL_SERVER__PORT sets server.port.
+	 * 
+	 * The environment is scanned once and each variable is looked up in the
+	 * index of option names, the number of options does not matter.
+	 * 
+	 * A flag is set by the values 1, true, yes and on and left alone by the
+	 * values 0, false, no, off, or an empty value. Other values are reported
+	 * as config_error::option_does_not_accept_argument. An empty value for
+	 * an option with an argument is ignored. Unknown names are reported as
+	 * config_error::unknown_option, unless unknown options are ignored.
+	 * 
+	 * As with config files, options that already have a value, e.g. from
+	 * the command line, are not changed, while options that can be repeated
+	 * get the value appended. Call this after parse and before parsing a
+	 * config file to have the environment take precedence over the config
+	 * file. Options set from the environment are kept when the config file
+	 * is reloaded.
+	 * 
+	 * @param prefix The prefix of the environment variables, e.g. MYTOOL_
+	 * @param envp An array of NAME=value strings, terminated by a nullptr
+	 * @param ec The variable receiving the error status
+	 */
+	void parse_environment(std::string_view prefix, const char *const envp[], std::error_code &ec)
+	{
+		for (auto env = envp; env != nullptr and *env != nullptr and not ec; ++env)
+		{
+			std::string_view var(*env);
+
+			if (var.compare(0, prefix.length(), prefix) != 0)
+				continue;
+
+			auto eq = var.find('=');
+			if (eq == std::string_view::npos or eq <= prefix.length())
+				continue;
+
+			set_environment_option(var.substr(prefix.length(), eq - prefix.length()), var.substr(eq + 1), ec);
+		}
+	}
+
+	/**
+	 * @brief Parse a new version of a configuration file in \a text, and
+	 * update the options to match. Return the names of the options whose
+	 * value changed. If an error is found it is returned in \a ec and no
+	 * option is changed.
+	 * 
+	 * Options specified on the command line are not affected. Other options
+	 * get the values found in \a text, or, when they are no longer present,
+	 * return to their default value. Values of options whose arguments
+	 * did not change are not converted again. An option counts as changed
+	 * when its converted value changed, a different text for the same
+	 * value like 010 for 10 only updates the argument.
+	 * 
+	 * The arguments are stored in memory that replaces that of the previous
+	 * reload, so reloading a file repeatedly does not use more and more
+	 * memory. Views returned by get<std::string_view> for options from a
+	 * config file are invalidated by a reload.
+	 * 
+	 * This modifies the config object, use @ref mcfp::config::publish to make
+	 * the result available to other threads.
+	 * 
+	 * @param text The new contents of the config file
+	 * @param ec The variable containing the error status
+	 * @return std::vector<std::string_view> The names of the changed options
+	 */
+	std::vector<std::string_view> reload_config_text(std::string_view text, std::error_code &ec)
+	{
+		config_text_context context;
+		return reload_config_text(text, context, ec);
+	}
+
+	/**
+	 * @brief Read a new version of the configuration file \a file, and
+	 * update the options to match, as @ref mcfp::config::reload_config_text
+	 * does. Included files are taken relative to the directory of \a file.
+	 * 
+	 * @param file The path to the config file
+	 * @param ec The variable containing the error status
+	 * @return std::vector<std::string_view> The names of the changed options
+	 */
+	std::vector<std::string_view> reload_config_file(const std::filesystem::path &file, std::error_code &ec)
+	{
+		detail::mapped_file mapped(file, ec);
+		if (ec)
+			return {};
+
+		config_text_context context(file);
+		auto result = reload_config_text(mapped.text(), context, ec);
+		if (not ec)
+			set_config_file(file, context);
+
+		return result;
+	}
+
+  private:
+#if __cpp_nontype_template_args >= 201911L
+	template <typename... Options>
+	friend class typed_config;
+#endif
+
+	friend class config_parser;
+
+	// A typed_config keeps a pointer to its own implementation, replacing
+	// that through the base class would leave the pointer dangling
+	void check_options_not_fixed() const
+	{
+		if (m_fixed_options)
+			throw std::system_error(std::make_error_code(std::errc::operation_not_permitted), "the options of a typed_config cannot be changed");
+	}
+
+	// The state of parse between two arguments
+	struct parse_state
+	{
+		option_base *pending = nullptr; // the option whose argument is the next argument
+		bool operands = false;          // all remaining arguments are operands
+	};
+
+	// Count how often each option that can be repeated occurs in argv, and
+	// reserve room for that many values. This way the values are stored
+	// without reallocation, even for millions of them. The count is only a
+	// hint, arguments of options and response files are not looked at.
+	void reserve_multiple_values(int argc, const char *const argv[])
+	{
+		for (int i = 1; i < argc and argv[i] != nullptr; ++i)
+		{
+			std::string_view arg(argv[i]);
+
+			if (arg.length() < 2 or arg.front() != '-')
+				continue;
+
+			if (arg == "--")
+				break;
+
+			option_base *opt;
+			if (arg[1] == '-')
+				opt = m_impl->get_option(arg.substr(2, arg.find('=') - 2));
+			else
+				opt = m_impl->get_option(arg[1]);
+
+			if (opt != nullptr and opt->m_multi)
+				++opt->m_reserve;
+		}
+
+		for (auto opt : m_impl->m_multi_options)
+		{
+			if (opt->m_reserve > 0)
+				opt->reserve(opt->m_reserve);
+			opt->m_reserve = 0;
+		}
+	}
+
+	// Process the argument \a arg, from argv or from a response file
+	void parse_argument(std::string_view arg, parse_state &state, std::error_code &ec)
+	{
+		if (state.pending != nullptr)
+		{
+			if (arg.empty())
+				ec = make_error_code(config_error::missing_argument_for_option);
+			else
+				state.pending->set_value(arg, ec);
+
+			state.pending = nullptr;
+			return;
+		}
+
+		// according to POSIX the first operand is the end of options, however,
+		// people nowadays expect to be able to mix operands and options
+		if (state.operands or arg.empty() or arg.front() != '-')
+		{
+			m_impl->add_operand(arg);
+			return;
+		}
+
+		if (arg == "--")
+		{
+			state.operands = true;
+			return;
+		}
+
+		option_base *opt = nullptr;
+		std::string_view opt_arg;
+
+		if (arg.length() > 1 and arg[1] == '-') // double --, start of new argument
+		{
+			std::string_view s_arg = arg.substr(2);
+			std::string_view::size_type p = s_arg.find('=');
+
+			if (p != std::string_view::npos)
+			{
+				opt_arg = s_arg.substr(p + 1);
+				s_arg = s_arg.substr(0, p);
+			}
+
+			opt = m_impl->get_option(s_arg);
+			if (opt == nullptr)
+			{
+				if (not m_ignore_unknown)
+					ec = make_error_code(config_error::unknown_option);
+				return;
+			}
+
+			opt->m_on_command_line = true;
+			++opt->m_seen;
+
+			if (opt->m_is_flag)
+			{
+				if (not opt_arg.empty())
+					ec = make_error_code(config_error::option_does_not_accept_argument);
+				return;
+			}
+		}
+		else // single character options
+		{
+			bool expect_option_argument = false;
+
+			for (size_t i = 1; i < arg.length() and not ec; ++i)
+			{
+				opt = m_impl->get_option(arg[i]);
+
+				if (opt == nullptr)
+				{
+					if (not m_ignore_unknown)
+						ec = make_error_code(config_error::unknown_option);
+					continue;
+				}
+
+				++opt->m_seen;
+				opt->m_on_command_line = true;
+
+				if (opt->m_is_flag)
+					continue;
+
+				opt_arg = arg.substr(i + 1);
+				expect_option_argument = true;
+				break;
+			}
+
+			if (not expect_option_argument)
+				return;
+		}
+
+		// So, the = character was not present, the next argument must be the option argument
+		if (opt_arg.empty())
+			state.pending = opt;
+		else
+			opt->set_value(opt_arg, ec);
+	}
+
+	// Process the arguments in the response file \a file
+	void parse_response_file(std::string_view file, parse_state &state, std::error_code &ec)
+	{
+		std::error_code file_ec;
+		auto mapped = std::make_unique<detail::mapped_file>(std::filesystem::path(file), file_ec, true);
+		if (file_ec)
 		{
-			options,
-			operands
-		} state = State::options;
+			ec = make_error_code(config_error::config_file_not_found);
+			return;
+		}
 
-		for (int i = 1; i < argc and not ec; ++i)
+		char *data = mapped->data();
+		size_t size = mapped->text().length();
+		m_impl->m_response_files.emplace_back(std::move(mapped));
+
+		detail::split_response_file(data, size, [this, &state](std::string_view arg, std::error_code &ec)
+		{
+			parse_argument(arg, state, ec);
+		}, ec);
+	}
+
+	// The state kept while reading a config file, the current section and
+	// the files being included
+	struct config_text_context
+	{
+		config_text_context() = default;
+
+		// The context for reading \a file itself
+		explicit config_text_context(const std::filesystem::path &file)
+			: dir(file.parent_path())
+		{
+			std::error_code ec;
+			auto path = std::filesystem::canonical(file, ec);
+			if (not ec)
+				stack.emplace_back(std::move(path));
+		}
+
+		std::filesystem::path dir;                                           // relative includes start here
+		std::vector<std::filesystem::path> stack;                            // the canonical paths of the files being read
+		std::vector<std::shared_ptr<const detail::tokenized_file>> included; // all files included so far
+		detail::config_section section;                                      // the current section
+		std::string section_name;                                            // storage for the section name
+
+		// Copy the name of the current section, for when the text it
+		// refers to is about to go away
+		void keep_section()
+		{
+			if (section.m_name.data() != section_name.data())
+			{
+				section_name.assign(section.m_name);
+				section.m_name = section_name;
+			}
+		}
+	};
+
+	static constexpr size_t kMaxIncludeDepth = 16;
+
+	// Remember \a file as the config file last read, and the files it included
+	void set_config_file(const std::filesystem::path &file, const config_text_context &context)
+	{
+		m_config_file = file;
+		m_included_files.clear();
+		for (auto &included : context.included)
+			m_included_files.emplace_back(included->m_path);
+	}
+
+	bool is_include(const detail::config_section &section, std::string_view name) const
+	{
+		return name == "include" and m_impl->get_option(section, name) == nullptr;
+	}
+
+	// Tokenize \a text and pass the options found to \a handler, replacing
+	// include directives with the options found in the included files
+	template <typename Handler>
+	void tokenize_config_file(std::string_view text, config_text_context &context, Handler &&handler, std::error_code &ec) const
+	{
+		detail::tokenize_config_text(text, context.section, [this, &context, &handler](const detail::config_section &section, std::string_view name, std::optional<std::string_view> value, std::error_code &ec)
+		{
+			if (is_include(section, name))
+				include_config_file(value, context, handler, ec);
+			else
+				handler(section, name, value, ec);
+		}, ec);
+	}
+
+	template <typename Handler>
+	void include_config_file(std::optional<std::string_view> value, config_text_context &context, Handler &handler, std::error_code &ec) const
+	{
+		// The value extends to the end of the line
+		while (value.has_value() and not value->empty() and detail::is_space(value->back()))
+			value->remove_suffix(1);
+
+		if (not value.has_value() or value->empty())
+		{
+			ec = make_error_code(config_error::missing_argument_for_option);
+			return;
+		}
+
+		auto file = context.dir / std::filesystem::path(*value);
+
+		std::error_code file_ec;
+		auto path = std::filesystem::canonical(file, file_ec);
+		if (file_ec)
+		{
+			ec = make_error_code(config_error::config_file_not_found);
+			return;
+		}
+
+		if (std::find(context.stack.begin(), context.stack.end(), path) != context.stack.end())
+		{
+			ec = make_error_code(config_error::include_cycle);
+			return;
+		}
+
+		if (context.stack.size() >= kMaxIncludeDepth)
+		{
+			ec = make_error_code(config_error::include_depth_exceeded);
+			return;
+		}
+
+		auto included = m_include_cache.get(path, file_ec);
+		if (file_ec)
+		{
+			ec = make_error_code(config_error::config_file_not_found);
+			return;
+		}
+
+		context.included.emplace_back(included);
+		context.stack.emplace_back(std::move(path));
+		auto dir = std::exchange(context.dir, file.parent_path());
+
+		// An included file starts outside any section, and does not
+		// change the section of the including file
+		for (auto &token : included->m_tokens)
+		{
+			if (ec)
+				break;
+
+			if (is_include(token.m_section, token.m_name))
+				include_config_file(token.m_value, context, handler, ec);
+			else
+				handler(token.m_section, token.m_name, token.m_value, ec);
+		}
+
+		if (not ec)
+			ec = included->m_ec;
+
+		context.dir = std::move(dir);
+		context.stack.pop_back();
+	}
+
+	// Parse \a text read in \a context, see the public version
+	void parse_config_text(std::string_view text, config_text_context &context, std::error_code &ec)
+	{
+		tokenize_config_file(text, context, [this](const detail::config_section &section, std::string_view name, std::optional<std::string_view> value, std::error_code &ec)
 		{
-			const char *arg = argv[i];
+			set_config_option(section, name, value, ec);
+		}, ec);
+	}
+
+	std::vector<std::string_view> reload_config_text(std::string_view text, config_text_context &context, std::error_code &ec)
+	{
+		config_text_contents contents;
+		collect_config_text(text, context, contents, ec);
+
+		// The arguments of this generation of the config file are stored in
+		// a fresh arena, which replaces that of the previous reload. This
+		// keeps the memory used bounded, however often the file is reloaded.
+		auto arena = std::make_unique<std::pmr::monotonic_buffer_resource>(m_impl->m_arena.upstream_resource());
 
-			if (arg == nullptr) // should not happen
+		// Set up the new state in copies first, so that a conversion
+		// error leaves all options untouched
+		std::vector<std::pair<option_base *, std::unique_ptr<option_base>>> updates;
+		std::vector<option_base *> unchanged;
+		const std::vector<std::string_view> none;
+
+		for (auto opt : m_impl->m_option_list)
+		{
+			if (ec)
 				break;
 
-			if (state == State::options)
+			if (opt->m_on_command_line)
+				continue;
+
+			std::unique_ptr<option_base> update;
+
+			if (opt->m_is_flag)
 			{
-				if (*arg != '-') // according to POSIX this is the end of options, start operands
-				                 // state = State::operands;
-				{                // however, people nowadays expect to be able to mix operands and options
-					m_impl->m_operands.emplace_back(arg);
+				auto i = contents.flags.find(opt);
+				int seen = i == contents.flags.end() ? 0 : i->second;
+
+				if (seen == opt->m_seen)
 					continue;
-				}
-				else if (arg[1] == '-' and arg[2] == 0)
+
+				update = opt->clone();
+				update->reset();
+				update->m_seen = seen;
+			}
+			else
+			{
+				auto i = contents.arguments.find(opt);
+				auto &args = i == contents.arguments.end() ? none : i->second;
+
+				if (opt->same_arguments(args))
 				{
-					state = State::operands;
+					unchanged.emplace_back(opt);
 					continue;
 				}
+
+				update = opt->clone();
+				update->reset();
+
+				for (auto arg : args)
+				{
+					update->set_value(detail::copy_text(arg, *arena), ec);
+					++update->m_seen;
+				}
 			}
 
-			if (state == State::operands)
+			updates.emplace_back(opt, std::move(update));
+		}
+
+		std::vector<std::string_view> result;
+
+		if (not ec)
+		{
+			for (auto &[opt, update] : updates)
 			{
-				m_impl->m_operands.emplace_back(arg);
-				continue;
+				// A different text for the same value, e.g. 010 for 10,
+				// is not a change
+				bool changed = update->m_seen != opt->m_seen or not update->same_value(*opt);
+
+				opt->assign(*update);
+				if (changed)
+					result.emplace_back(opt->m_name);
 			}
 
-			option_base *opt = nullptr;
-			std::string_view opt_arg;
+			// The options that did not change still refer to the text
+			// of the previous generation
+			for (auto opt : unchanged)
+				opt->copy_arguments(*arena);
 
-			assert(*arg == '-');
-			++arg;
+			m_impl->m_reload_arena = std::move(arena);
+		}
+
+		return result;
+	}
 
-			if (*arg == '-') // double --, start of new argument
+	// Parse the complete lines in \a partial followed by \a chunk, and
+	// leave the incomplete last line, if any, in \a partial
+	void feed_config_text(config_text_context &context, std::string &partial, std::string_view chunk, std::error_code &ec)
+	{
+		if (not partial.empty())
+		{
+			auto eoln = detail::scanner::best().skip_line(chunk.data(), chunk.data() + chunk.length());
+
+			if (eoln == chunk.data() + chunk.length())
 			{
-				++arg;
+				partial += chunk;
+				return;
+			}
 
-				assert(*arg != 0); // this should not happen, as it was checked for before
+			size_t n = eoln - chunk.data() + 1;
 
-				std::string_view s_arg(arg);
-				std::string_view::size_type p = s_arg.find('=');
+			partial += chunk.substr(0, n);
+			chunk.remove_prefix(n);
 
-				if (p != std::string_view::npos)
-				{
-					opt_arg = s_arg.substr(p + 1);
-					s_arg = s_arg.substr(0, p);
-				}
+			parse_config_text(partial, context, ec);
+			context.keep_section();
+			partial.clear();
 
-				opt = m_impl->get_option(s_arg);
-				if (opt == nullptr)
+			if (ec)
+				return;
+		}
+
+		// Apart from the section, the lines in a config file are independent,
+		// everything up to the last end of line can be parsed right away
+		size_t n = chunk.length();
+		while (n > 0 and not detail::is_eoln(chunk[n - 1]))
+			--n;
+
+		parse_config_text(chunk.substr(0, n), context, ec);
+		context.keep_section();
+		partial.assign(chunk.substr(n));
+	}
+
+	// The options found in the text of a config file
+	struct config_text_contents
+	{
+		std::unordered_map<option_base *, std::vector<std::string_view>> arguments;
+		std::unordered_map<option_base *, int> flags;
+	};
+
+	// Collect the arguments for each option in \a text, using the same
+	// rules as parse_config_text, but without changing the options
+	void collect_config_text(std::string_view text, config_text_context &context, config_text_contents &contents, std::error_code &ec) const
+	{
+		tokenize_config_file(text, context, [this, &contents](const detail::config_section &section, std::string_view name, std::optional<std::string_view> value, std::error_code &ec)
+		{
+			auto opt = m_impl->get_option(section, name);
+
+			if (opt == nullptr)
+			{
+				if (not m_ignore_unknown)
+					ec = make_error_code(config_error::unknown_option);
+			}
+			else if (not value.has_value())
+			{
+				if (not opt->m_is_flag)
+					ec = make_error_code(config_error::missing_argument_for_option);
+				else
+					++contents.flags[opt];
+			}
+			else if (opt->m_is_flag)
+				ec = make_error_code(config_error::option_does_not_accept_argument);
+			else if (auto &args = contents.arguments[opt]; not value->empty() and (args.empty() or opt->m_multi))
+				args.emplace_back(*value);
+		}, ec);
+	}
+
+	// A hash over the names and types of the options, for the config cache
+	uint64_t schema_hash() const
+	{
+		uint64_t result = detail::hash_bytes(m_ignore_unknown ? "ignore-unknown" : "");
+
+		for (auto opt : m_impl->m_option_list)
+		{
+			result = detail::hash_bytes(opt->m_name, result);
+			result = detail::hash_bytes(opt->m_type ? opt->m_type->name() : "", result);
+
+			const char flags[] = { opt->m_short_name, opt->m_is_flag, opt->m_multi };
+			result = detail::hash_bytes({ flags, sizeof(flags) }, result);
+		}
+
+		return result;
+	}
+
+	// Write the records for the options found in \a text to \a image.
+	// Each record contains the index of the option, the number of times
+	// a flag was seen and the arguments, each followed by the binary value.
+	void build_config_cache(std::string_view text, config_text_context &context, detail::config_cache_writer &image, std::error_code &ec) const
+	{
+		config_text_contents contents;
+		collect_config_text(text, context, contents, ec);
+
+		auto &options = m_impl->m_option_list;
+
+		for (uint32_t ix = 0; ix < options.size() and not ec; ++ix)
+		{
+			auto opt = options[ix];
+
+			if (opt->m_is_flag)
+			{
+				if (auto i = contents.flags.find(opt); i != contents.flags.end())
 				{
-					if (not m_ignore_unknown)
-						ec = make_error_code(config_error::unknown_option);
-					continue;
+					image.write(ix);
+					image.write(static_cast<uint32_t>(i->second));
+					image.write(uint32_t{ 0 });
 				}
+				continue;
+			}
 
-				if (opt->m_is_flag)
-				{
-					if (not opt_arg.empty())
-						ec = make_error_code(config_error::option_does_not_accept_argument);
+			auto i = contents.arguments.find(opt);
+			if (i == contents.arguments.end() or i->second.empty())
+				continue;
 
-					++opt->m_seen;
-					continue;
-				}
+			auto &args = i->second;
 
-				++opt->m_seen;
+			// Convert the values in a copy of the option
+			auto copy = opt->clone();
+			copy->reset();
+			for (auto arg : args)
+				copy->set_value(arg, ec);
+
+			image.write(ix);
+			image.write(uint32_t{ 0 });
+			image.write(static_cast<uint32_t>(args.size()));
+
+			std::string binary;
+			for (size_t n = 0; n < args.size(); ++n)
+			{
+				binary.clear();
+				copy->append_binary_value(n, binary);
+
+				image.write(args[n]);
+				image.write(binary);
 			}
-			else // single character options
+		}
+	}
+
+	// Apply the records in the cache image \a data, if it is valid and its
+	// header is equal to \a header. Unless \a check_includes is false the
+	// included files must not have changed either. Returns true if the
+	// image was used.
+	bool load_config_cache(std::string_view data, const detail::config_cache_header &header, std::error_code &ec,
+		bool check_includes = true)
+	{
+		const auto &options = m_impl->m_option_list;
+
+		// First check the complete image, so that a damaged image changes nothing
+		detail::config_cache_reader reader(data);
+
+		detail::config_cache_header cached;
+		if (not reader.read(cached) or not (cached == header) or not read_cached_includes(reader, check_includes))
+			return false;
+
+		while (not reader.empty())
+		{
+			uint32_t ix = 0, seen = 0, count = 0;
+			if (not reader.read(ix) or not reader.read(seen) or not reader.read(count) or ix >= options.size())
+				return false;
+
+			for (std::string_view text; count > 0; --count)
 			{
-				bool expect_option_argument = false;
+				if (not reader.read(text) or not reader.read(text))
+					return false;
+			}
+		}
 
-				while (*arg != 0 and not ec)
-				{
-					opt = m_impl->get_option(*arg++);
+		reader = detail::config_cache_reader(data);
+		reader.read(cached);
+		read_cached_includes(reader, false, &m_included_files);
+
+		while (not reader.empty() and not ec)
+		{
+			uint32_t ix = 0, seen = 0, count = 0;
+			reader.read(ix);
+			reader.read(seen);
+			reader.read(count);
 
-					if (opt == nullptr)
-					{
-						if (not m_ignore_unknown)
-							ec = make_error_code(config_error::unknown_option);
-						continue;
-					}
+			auto opt = options[ix];
+			opt->m_seen += seen;
 
-					++opt->m_seen;
-					if (opt->m_is_flag)
-						continue;
+			for (; count > 0 and not ec; --count)
+			{
+				std::string_view arg, binary;
+				reader.read(arg);
+				reader.read(binary);
 
-					opt_arg = arg;
-					expect_option_argument = true;
-					break;
+				if (opt->m_seen == 0 or opt->m_multi)
+				{
+					auto value = m_impl->store(arg);
+					if (not opt->set_binary_value(value, binary))
+						opt->set_value(value, ec);
+					++opt->m_seen;
 				}
-
-				if (not expect_option_argument)
-					continue;
 			}
+		}
+
+		return true;
+	}
+
+	// Read the list of included files in a cache image, if \a check is
+	// true each of them must still have the same size and modification time
+	static bool read_cached_includes(detail::config_cache_reader &reader, bool check, std::vector<std::filesystem::path> *paths = nullptr)
+	{
+		uint32_t count = 0;
+		if (not reader.read(count))
+			return false;
+
+		if (paths != nullptr)
+			paths->clear();
+
+		for (; count > 0; --count)
+		{
+			std::string_view path;
+			uint64_t size = 0;
+			int64_t mtime = 0;
+			if (not reader.read(path) or not reader.read(size) or not reader.read(mtime))
+				return false;
+
+			if (paths != nullptr)
+				paths->emplace_back(path);
 
-			if (opt_arg.empty() and i + 1 < argc) // So, the = character was not present, the next arg must be the option argument
+			if (check)
 			{
-				++i;
-				opt_arg = argv[i];
+				std::error_code ec;
+				auto stamp = detail::file_stamp(std::filesystem::path(path), ec);
+				if (ec or stamp != std::make_pair(size, mtime))
+					return false;
 			}
+		}
+
+		return true;
+	}
+
+	// Write \a data to \a file, replacing it atomically. Errors are ignored.
+	static void write_config_cache(const std::filesystem::path &file, const std::string &data)
+	{
+		auto tmp = file;
+		tmp += ".tmp-" + std::to_string(std::random_device{}());
+
+		std::ofstream os(tmp, std::ios::binary);
+		if (not os.is_open())
+			return;
+
+		os.write(data.data(), data.length());
+		os.close();
+
+		std::error_code ec;
+		if (os.fail())
+			std::filesystem::remove(tmp, ec);
+		else
+		{
+			std::filesystem::rename(tmp, file, ec);
+			if (ec)
+				std::filesystem::remove(tmp, ec);
+		}
+	}
+
+	// Process a line from a config file, \a value is empty if the
+	// line contained only the name of the option
+	void set_config_option(const detail::config_section &section, std::string_view name, std::optional<std::string_view> value, std::error_code &ec)
+	{
+		auto opt = m_impl->get_option(section, name);
 
-			if (opt_arg.empty())
+		if (opt == nullptr)
+		{
+			if (not m_ignore_unknown)
+				ec = make_error_code(config_error::unknown_option);
+		}
+		else if (not value.has_value())
+		{
+			if (not opt->m_is_flag)
 				ec = make_error_code(config_error::missing_argument_for_option);
 			else
-				opt->set_value(opt_arg, ec);
+				++opt->m_seen;
+		}
+		else if (opt->m_is_flag)
+			ec = make_error_code(config_error::option_does_not_accept_argument);
+		else if (not value->empty() and (opt->m_seen == 0 or opt->m_multi))
+		{
+			opt->set_value(m_impl->store(*value), ec);
+			++opt->m_seen;
 		}
 	}
 
-  private:
-	config() = default;
-	config(const config &) = delete;
-	config &operator=(const config &) = delete;
+	// Process the environment variable \a name, with the prefix removed,
+	// having value \a value
+	void set_environment_option(std::string_view name, std::string_view value, std::error_code &ec)
+	{
+		std::array<char, 256> buffer;
+
+		auto opt = m_impl->get_option(detail::environment_to_option_name(name, buffer, false));
+		if (opt == nullptr)
+			opt = m_impl->get_option(detail::environment_to_option_name(name, buffer, true));
+
+		if (opt == nullptr)
+		{
+			if (not m_ignore_unknown)
+				ec = make_error_code(config_error::unknown_option);
+		}
+		else if (opt->m_is_flag)
+		{
+			auto set = detail::environment_flag_value(value);
+
+			if (not set.has_value())
+				ec = make_error_code(config_error::option_does_not_accept_argument);
+			else if (*set and opt->m_seen == 0)
+			{
+				++opt->m_seen;
+				opt->m_on_command_line = true;
+			}
+		}
+		else if (not value.empty() and (opt->m_seen == 0 or opt->m_multi))
+		{
+			opt->set_value(m_impl->store(value), ec);
+			++opt->m_seen;
+			opt->m_on_command_line = true;
+		}
+	}
+
+	/// @cond
+
+	struct config_impl_base;
+
+	// Used for snapshots
+	config(std::unique_ptr<config_impl_base> impl, std::string usage)
+		: m_impl(std::move(impl))
+		, m_usage(std::move(usage))
+	{
+	}
+
+	struct config_impl_base
+	{
+		config_impl_base(std::pmr::memory_resource *resource, size_t text_size)
+			: m_arena(std::max<size_t>(text_size, 1024), resource)
+		{
+		}
+
+		virtual ~config_impl_base() = default;
+
+		option_base *get_option(std::string_view name) const
+		{
+			return m_index.find(name);
+		}
+
+		// Look up the option \a name in \a section, using the hash of the
+		// section name calculated by the tokenizer
+		option_base *get_option(const detail::config_section &section, std::string_view name) const
+		{
+			if (section.m_name.empty())
+				return m_index.find(name);
+			return m_index.find(section.m_name, section.m_hash, name);
+		}
+
+		option_base *get_option(char short_name) const
+		{
+			return m_short_index[static_cast<unsigned char>(short_name)];
+		}
 
-	/// @cond
+		// Copy the name and description of \a opt into the arena
+		// and add the option to the indices
+		void add_option(option_base &opt)
+		{
+			if (not opt.m_static_text)
+			{
+				opt.m_name = store(opt.m_name);
+				opt.m_desc = store(opt.m_desc);
+			}
 
-	struct config_impl_base
-	{
-		virtual ~config_impl_base() = default;
+			m_index.insert(opt.m_name, &opt);
+			m_option_list.emplace_back(&opt);
+			if (opt.m_multi)
+				m_multi_options.emplace_back(&opt);
 
-		virtual option_base *get_option(std::string_view name) = 0;
-		virtual option_base *get_option(char short_name) = 0;
+			auto &short_opt = m_short_index[static_cast<unsigned char>(opt.m_short_name)];
+			if (opt.m_short_name != 0 and short_opt == nullptr)
+				short_opt = &opt;
+		}
 
 		virtual size_t get_option_width() const = 0;
 		virtual void write(std::ostream &os, size_t width) const = 0;
 
-		std::vector<std::string> m_operands;
-	};
-
-	template <typename... Options>
-	struct config_impl : public config_impl_base
-	{
-		static constexpr size_t N = sizeof...(Options);
+		// Return a deep copy, one that does not refer to this object
+		virtual std::unique_ptr<config_impl_base> clone() const = 0;
 
-		config_impl(Options... options)
-			: m_options(std::forward<Options>(options)...)
+		// The size of the text copied by add_option
+		static size_t text_size(const option_base &opt)
 		{
+			return opt.m_static_text ? 0 : opt.m_name.length() + opt.m_desc.length();
 		}
 
-		option_base *get_option(std::string_view name) override
+		// Keep a copy of \a text for as long as this object exists
+		std::string_view store(std::string_view text)
 		{
-			return get_option<0>(name);
+			return detail::copy_text(text, m_arena);
 		}
 
-		template <size_t Ix>
-		option_base *get_option([[maybe_unused]] std::string_view name)
+		// Make room for \a count more operands. The room grows at least
+		// twice as large, the arena does not reuse the memory left behind.
+		void reserve_operands(size_t count)
 		{
-			if constexpr (Ix == N)
-				return nullptr;
-			else
+			size_t size = m_operands.size() + count;
+			if (size > m_operands.capacity())
 			{
-				option_base &opt = std::get<Ix>(m_options);
-				return (opt.m_name == name) ? &opt : get_option<Ix + 1>(name);
+				size = std::max(size, 2 * m_operands.capacity());
+				m_operands.reserve(size);
+				m_operand_text.reserve(size);
 			}
 		}
 
-		option_base *get_option(char short_name) override
+		// Add the operand \a operand, a view on argv or a response file,
+		// the text is copied as well for operand_strings
+		void add_operand(std::string_view operand)
 		{
-			return get_option<0>(short_name);
+			m_operands.emplace_back(operand);
+			m_operand_text.emplace_back(store(operand));
 		}
 
-		template <size_t Ix>
-		option_base *get_option([[maybe_unused]] char short_name)
+		// The operands as strings, created on first use
+		const std::vector<std::string> &operand_strings() const
 		{
-			if constexpr (Ix == N)
-				return nullptr;
-			else
+			std::lock_guard lock(m_operand_mutex);
+			if (m_operand_strings.size() != m_operand_text.size())
+				m_operand_strings.assign(m_operand_text.begin(), m_operand_text.end());
+			return m_operand_strings;
+		}
+
+		// Copy the operands of \a impl into the arena
+		void copy_operands(const config_impl_base &impl)
+		{
+			m_operands.reserve(impl.m_operand_text.size());
+			m_operand_text.reserve(impl.m_operand_text.size());
+			for (auto operand : impl.m_operand_text)
 			{
-				option_base &opt = std::get<Ix>(m_options);
-				return (opt.m_short_name == short_name) ? &opt : get_option<Ix + 1>(short_name);
+				m_operands.emplace_back(store(operand));
+				m_operand_text.emplace_back(m_operands.back());
 			}
 		}
 
+		std::pmr::monotonic_buffer_resource m_arena;
+		std::pmr::vector<std::string_view> m_operands{ &m_arena };     // views on argv
+		std::pmr::vector<std::string_view> m_operand_text{ &m_arena }; // the same, copied into the arena
+		mutable std::vector<std::string> m_operand_strings;
+		mutable std::mutex m_operand_mutex;
+		std::vector<std::unique_ptr<detail::mapped_file>> m_response_files; // the options and operands may refer to these
+		std::unique_ptr<std::pmr::monotonic_buffer_resource> m_reload_arena; // the arguments of the last reloaded config file
+		detail::name_index<option_base> m_index;
+		std::array<option_base *, 256> m_short_index{};
+		std::vector<option_base *> m_option_list;
+		std::vector<option_base *> m_multi_options; // the options in m_option_list that can be repeated
+	};
+
+	template <typename... Options>
+	struct config_impl : public config_impl_base
+	{
+		static constexpr size_t N = sizeof...(Options);
+
+		config_impl(std::pmr::memory_resource *resource, Options... options)
+			: config_impl_base(resource, (text_size(options) + ... + 0))
+			, m_options(std::forward<Options>(options)...)
+		{
+			m_index.reserve(N);
+			std::apply([this](Options &...opts) {
+				(add_option(opts), ...);
+			}, m_options);
+		}
+
 		virtual size_t get_option_width() const override
 		{
 			return std::apply([](Options const& ...opts) {
@@ -707,16 +2280,197 @@ class config
 			}, m_options);
 		}
 
+		virtual std::unique_ptr<config_impl_base> clone() const override
+		{
+			// The constructor copies names and descriptions, arguments and operands
+			// are copied here
+			auto result = std::apply([this](Options const& ...opts) {
+				return std::make_unique<config_impl>(m_arena.upstream_resource(), opts...);
+			}, m_options);
+
+			std::apply([&arena = result->m_arena](Options &...opts) {
+				(opts.copy_arguments(arena), ...);
+			}, result->m_options);
+
+			result->copy_operands(*this);
+
+			return result;
+		}
+
 		std::tuple<Options...> m_options;
 	};
 
+	// The implementation for an option_set
+	struct config_dynamic_impl : public config_impl_base
+	{
+		config_dynamic_impl(std::pmr::memory_resource *resource, std::vector<std::unique_ptr<option_base>> options)
+			: config_impl_base(resource, text_size(options))
+			, m_options(std::move(options))
+		{
+			m_index.reserve(m_options.size());
+			for (auto &opt : m_options)
+				add_option(*opt);
+		}
+
+		static size_t text_size(const std::vector<std::unique_ptr<option_base>> &options)
+		{
+			size_t result = 0;
+			for (auto &opt : options)
+				result += config_impl_base::text_size(*opt);
+			return result;
+		}
+
+		virtual size_t get_option_width() const override
+		{
+			size_t width = 0;
+			for (auto &opt : m_options)
+				width = std::max(width, opt->width());
+			return width;
+		}
+
+		virtual void write(std::ostream &os, size_t width) const override
+		{
+			for (auto &opt : m_options)
+				opt->write(os, width);
+		}
+
+		virtual std::unique_ptr<config_impl_base> clone() const override
+		{
+			std::vector<std::unique_ptr<option_base>> options;
+			options.reserve(m_options.size());
+			for (auto &opt : m_options)
+				options.emplace_back(opt->clone());
+
+			auto result = std::make_unique<config_dynamic_impl>(m_arena.upstream_resource(), std::move(options));
+
+			for (auto &opt : result->m_options)
+				opt->copy_arguments(result->m_arena);
+
+			result->copy_operands(*this);
+
+			return result;
+		}
+
+		std::vector<std::unique_ptr<option_base>> m_options;
+	};
+
 	std::unique_ptr<config_impl_base> m_impl;
+	std::pmr::memory_resource *m_resource = std::pmr::get_default_resource();
 	bool m_ignore_unknown = false;
+	bool m_response_files = false;
+	bool m_fixed_options = false;
 	std::string m_usage;
+	std::filesystem::path m_config_file;
+	std::vector<std::filesystem::path> m_included_files;
+	mutable detail::include_cache m_include_cache;
+
+#if __cpp_lib_atomic_shared_ptr >= 201711L
+	std::atomic<std::shared_ptr<const config>> m_snapshot;
+#else
+	std::shared_ptr<const config> m_snapshot;
+#endif
 
 	/// @endcond
 };
 
+// --------------------------------------------------------------------
+/**
+ * @brief A parser for config files that arrive in pieces, e.g. through
+ * a pipe or a socket. Each piece is parsed as soon as it is passed to
+ * @ref mcfp::config_parser::feed, only an incomplete last line is kept
+ * until the next piece arrives.
+ * 
+ * @code{.cpp}
+ * mcfp::config_parser parser(config);
+ * 
+ * while (auto n = ::read(fd, buffer, sizeof(buffer)); n > 0)
+ * 	parser.feed({ buffer, size_t(n) }, ec);
+ * 
+ * parser.finish(ec);
+ * @endcode
+ * 
+ * After an error, further calls to feed and finish return that same error.
+ */
+
+class config_parser
+{
+  public:
+	/**
+	 * @brief Construct a new parser that stores the options found in \a config
+	 * 
+	 * @param config The config object receiving the options, it must
+	 * outlive this parser
+	 */
+	explicit config_parser(config &config)
+		: m_config(config)
+	{
+	}
+
+	config_parser(const config_parser &) = delete;
+	config_parser &operator=(const config_parser &) = delete;
+
+	/**
+	 * @brief Parse the next piece of text in \a chunk. The text need not
+	 * remain valid after this call. If an error is found it is returned
+	 * in \a ec
+	 * 
+	 * @param chunk The next piece of the config file
+	 * @param ec The variable containing the error status
+	 */
+	void feed(std::string_view chunk, std::error_code &ec)
+	{
+		if (not m_ec)
+			m_config.feed_config_text(m_context, m_partial, chunk, m_ec);
+		ec = m_ec;
+	}
+
+	/**
+	 * @brief Parse the next piece of text in \a chunk, throws an exception
+	 * if an error was found
+	 * 
+	 * @param chunk The next piece of the config file
+	 */
+	void feed(std::string_view chunk)
+	{
+		std::error_code ec;
+		feed(chunk, ec);
+		if (ec)
+			throw std::system_error(ec);
+	}
+
+	/**
+	 * @brief Parse the last line, if it was not terminated by an end of line.
+	 * If an error is found it is returned in \a ec
+	 * 
+	 * @param ec The variable containing the error status
+	 */
+	void finish(std::error_code &ec)
+	{
+		if (not m_ec)
+			m_config.parse_config_text(m_partial, m_context, m_ec);
+		m_partial.clear();
+		ec = m_ec;
+	}
+
+	/**
+	 * @brief Parse the last line, if it was not terminated by an end of line.
+	 * Throws an exception if an error was found
+	 */
+	void finish()
+	{
+		std::error_code ec;
+		finish(ec);
+		if (ec)
+			throw std::system_error(ec);
+	}
+
+  private:
+	config &m_config;
+	config::config_text_context m_context;
+	std::string m_partial;
+	std::error_code m_ec;
+};
+
 // --------------------------------------------------------------------
 
 /**
@@ -822,6 +2576,315 @@ auto make_hidden_option(std::string_view name, const T &v, std::string_view desc
 	return detail::option<T>(name, v, description, true);
 }
 
+// --------------------------------------------------------------------
+/**
+ * @brief A description of an option that is stored entirely in static,
+ * read-only data.
+ * 
+ * All members are views. Options created from an option_spec with
+ * mcfp::make_option refer to this text directly, initialising a config with
+ * them does not allocate memory for names and descriptions. When the compiler
+ * supports consteval, an option_spec can only be created at compile time,
+ * which guarantees the text it refers to remains valid. A default value for
+ * a flag or for an option that can be repeated is then a compile error.
+ * 
+ * @code{.cpp}
+ * constexpr mcfp::option_spec<int> kThreads{ "threads,t", "Number of threads", "4" };
+ * 
+ * config.init("usage: example [options]", mcfp::make_option(kThreads));
+ * @endcode
+ * 
+ * @tparam T The type of the option, void for flags and a container for
+ * options that can be repeated
+ */
+
+template <typename T = void>
+struct option_spec
+{
+#if __cpp_consteval >= 201811L
+	consteval
+#else
+	constexpr
+#endif
+	option_spec(std::string_view name, std::string_view description,
+		std::string_view default_value = {}, bool hidden = false)
+		: m_name(name)
+		, m_description(description)
+		, m_default_value(default_value)
+		, m_hidden(hidden)
+	{
+		// evaluated at compile time, a throw here is a compile error
+		if (not default_value.empty())
+			check_default_value();
+	}
+
+	/**
+	 * @brief Throw a std::system_error if the option cannot have a default
+	 * value, that is if it is a flag or can be repeated
+	 */
+	static constexpr void check_default_value()
+	{
+		if constexpr (std::is_void_v<T>)
+			throw std::system_error(make_error_code(config_error::option_does_not_accept_argument), "a flag cannot have a default value");
+		else if constexpr (detail::is_container_type_v<T>)
+			throw std::system_error(std::make_error_code(std::errc::invalid_argument), "an option that can be repeated cannot have a default value");
+	}
+
+	std::string_view m_name;          ///< The name, optionally followed by a comma and the short name
+	std::string_view m_description;   ///< The help text
+	std::string_view m_default_value; ///< The default value as text, empty if there is none
+	bool m_hidden;                    ///< When true, the option is hidden from the help text
+};
+
+/**
+ * @brief Create an option from the static description \a spec. The
+ * default value, if any, is converted using the same rules as command line
+ * arguments. An exception is thrown if this conversion fails, or if \a spec
+ * has a default value for a flag or an option that can be repeated.
+ * 
+ * @tparam T The type of the option
+ * @param spec The description of the option
+ * @return auto The option object created
+ */
+template <typename T>
+auto make_option(const option_spec<T> &spec)
+{
+	if (not spec.m_default_value.empty())
+		spec.check_default_value();
+
+	if constexpr (detail::is_container_type_v<T>)
+	{
+		detail::multiple_option<T> result(spec.m_name, spec.m_description, spec.m_hidden);
+		result.m_static_text = true;
+		return result;
+	}
+	else
+	{
+		detail::option<T> result(spec.m_name, spec.m_description, spec.m_hidden);
+		result.m_static_text = true;
+
+		if constexpr (not std::is_void_v<T>)
+		{
+			if (not spec.m_default_value.empty())
+			{
+				std::error_code ec;
+				result.m_value = result.m_default = detail::option_traits<T>::set_value(spec.m_default_value, ec);
+				if (ec)
+					throw std::system_error(ec, std::string{ spec.m_name });
+				result.m_has_default = true;
+			}
+		}
+
+		return result;
+	}
+}
+
+#if __cpp_nontype_template_args >= 201911L
+
+// --------------------------------------------------------------------
+// Options with names known at compile time, for use with typed_config
+
+/**
+ * @brief Create an option with the compile time name \a Name and without
+ * a default value. If \a T is void the option does not expect a value and
+ * is in fact a flag. The value can be retrieved from a @ref mcfp::typed_config
+ * using the name as template argument.
+ * 
+ * The name \a Name may end with a comma and a single character. This last
+ * character will then be the short version whereas the leading characters
+ * make up the long version.
+ * 
+ * @tparam Name The name of the option, a string literal
+ * @tparam T The type of the option
+ * @param description The help text for this option
+ * @return auto The option object created
+ */
+template <detail::fixed_string Name, typename T = void, std::enable_if_t<not detail::is_container_type_v<T>, int> = 0>
+auto make_option(std::string_view description)
+{
+	return detail::named_option<Name, detail::option<T>>(description, false);
+}
+
+template <detail::fixed_string Name, typename T, std::enable_if_t<detail::is_container_type_v<T>, int> = 0>
+auto make_option(std::string_view description)
+{
+	return detail::named_option<Name, detail::multiple_option<T>>(description, false);
+}
+
+/**
+ * @brief Create an option with the compile time name \a Name and with a
+ * default value \a v.
+ * 
+ * @tparam Name The name of the option, a string literal
+ * @tparam T The type of the option
+ * @param v The default value to use
+ * @param description The help text for this option
+ * @return auto The option object created
+ */
+template <detail::fixed_string Name, typename T, std::enable_if_t<not detail::is_container_type_v<T>, int> = 0>
+auto make_option(const T &v, std::string_view description)
+{
+	return detail::named_option<Name, detail::option<T>>(v, description, false);
+}
+
+/**
+ * @brief Create a hidden option with the compile time name \a Name and
+ * without a default value.
+ * 
+ * @tparam Name The name of the option, a string literal
+ * @tparam T The type of the option
+ * @param description The help text for this option
+ * @return auto The option object created
+ */
+template <detail::fixed_string Name, typename T = void, std::enable_if_t<not detail::is_container_type_v<T>, int> = 0>
+auto make_hidden_option(std::string_view description)
+{
+	return detail::named_option<Name, detail::option<T>>(description, true);
+}
+
+template <detail::fixed_string Name, typename T, std::enable_if_t<detail::is_container_type_v<T>, int> = 0>
+auto make_hidden_option(std::string_view description)
+{
+	return detail::named_option<Name, detail::multiple_option<T>>(description, true);
+}
+
+/**
+ * @brief Create a hidden option with the compile time name \a Name and
+ * with default value \a v.
+ * 
+ * @tparam Name The name of the option, a string literal
+ * @tparam T The type of the option
+ * @param v The default value to use
+ * @param description The help text for this option
+ * @return auto The option object created
+ */
+template <detail::fixed_string Name, typename T, std::enable_if_t<not detail::is_container_type_v<T>, int> = 0>
+auto make_hidden_option(const T &v, std::string_view description)
+{
+	return detail::named_option<Name, detail::option<T>>(v, description, true);
+}
+
+// --------------------------------------------------------------------
+/**
+ * @brief A config object whose set of options is part of its type.
+ * 
+ * Options created with a compile time name, e.g. make_option<"threads,t", int>,
+ * can be accessed using that name as template argument. The name is resolved
+ * to the option at compile time, a misspelled name results in a compile error.
+ * 
+ * All other functionality of @ref mcfp::config, like parsing and looking up
+ * options by a runtime name, is available as well.
+ * 
+ * @code{.cpp}
+ * mcfp::typed_config config("usage: example [options]",
+ *     mcfp::make_option<"verbose,v">("Verbose output"),
+ *     mcfp::make_option<"threads,t", int>(4, "Number of threads"));
+ * 
+ * config.parse(argc, argv);
+ * int threads = config.get<"threads">();
+ * @endcode
+ */
+
+template <typename... Options>
+class typed_config : public config
+{
+	using impl_type = config_impl<Options...>;
+
+	static constexpr size_t N = sizeof...(Options);
+
+	template <detail::fixed_string Name>
+	static constexpr size_t index_of()
+	{
+		constexpr std::string_view names[] = { detail::static_name<Options>()..., {} };
+
+		size_t ix = 0;
+		while (ix < N and names[ix] != Name.long_name())
+			++ix;
+		return ix;
+	}
+
+	template <detail::fixed_string Name>
+	using option_type = std::tuple_element_t<index_of<Name>(), std::tuple<Options...>>;
+
+  public:
+	/**
+	 * @brief Construct a new typed config object with a \a usage message
+	 * and a set of \a options
+	 * 
+	 * @param usage The usage message
+	 * @param options Variadic list of options, use mcfp::make_option and variants to create these
+	 */
+	typed_config(std::string_view usage, Options... options)
+	{
+		m_typed_impl = new impl_type(m_resource, std::forward<Options>(options)...);
+		m_impl.reset(m_typed_impl);
+		m_usage = usage;
+		m_fixed_options = true;
+	}
+
+	/// The set of options is fixed, init cannot be used
+	template <typename... Args>
+	void init(Args &&...) = delete;
+
+	using config::count;
+	using config::get;
+	using config::has;
+
+	/**
+	 * @brief Return true if the option with name \a Name has a value assigned
+	 * 
+	 * @tparam Name The name of the option
+	 */
+	template <detail::fixed_string Name>
+		requires(index_of<Name>() < N)
+	bool has() const
+	{
+		const option_base &opt = std::get<index_of<Name>()>(m_typed_impl->m_options);
+		return opt.m_seen > 0 or opt.m_has_default;
+	}
+
+	/**
+	 * @brief Return how often the option with name \a Name was seen
+	 * 
+	 * @tparam Name The name of the option
+	 */
+	template <detail::fixed_string Name>
+		requires(index_of<Name>() < N)
+	int count() const
+	{
+		const option_base &opt = std::get<index_of<Name>()>(m_typed_impl->m_options);
+		return opt.m_seen;
+	}
+
+	/**
+	 * @brief Return the value of the option with name \a Name. Throws an
+	 * exception if the option has no value assigned.
+	 * 
+	 * @tparam Name The name of the option
+	 * @return The value, of the exact type the option stores
+	 */
+	template <detail::fixed_string Name>
+		requires(index_of<Name>() < N) && (not detail::is_flag_option_v<option_type<Name>>)
+	const auto &get() const
+	{
+		const auto &opt = std::get<index_of<Name>()>(m_typed_impl->m_options);
+
+		if constexpr (detail::is_multiple_option_v<option_type<Name>>)
+			return opt.m_values;
+		else
+		{
+			if (not opt.m_value.has_value())
+				throw std::system_error(make_error_code(config_error::option_not_specified), std::string{ Name.long_name() });
+			return *opt.m_value;
+		}
+	}
+
+  private:
+	impl_type *m_typed_impl;
+};
+
+#endif
+
 } // namespace mcfp
 
 namespace std
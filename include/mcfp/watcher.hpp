@@ -0,0 +1,332 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/// \file
+/// A watcher for config files, reloading them when they change. This is
+/// only available on systems that provide inotify.
+
+#include <mcfp/mcfp.hpp>
+
+#if __has_include(<sys/inotify.h>)
+
+#include <cerrno>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace mcfp
+{
+
+// --------------------------------------------------------------------
+/**
+ * @brief Watch a config file and reload it, using
+ * @ref mcfp::config::reload_config_file, each time it changes.
+ * 
+ * The directory containing the file is watched, so editors that replace
+ * the file by renaming a new version over it are handled as well. Files
+ * included by the config file, see @ref mcfp::config::included_files, are
+ * watched too, the set of watched files is updated after each reload. Changes
+ * are processed by calling @ref mcfp::config_watcher::poll, from the main
+ * loop of the program or from a dedicated thread. Each callback registered
+ * with @ref mcfp::config_watcher::on_change is then called with the names
+ * of the options that changed.
+ * 
+ * @code{.cpp}
+ * config.parse_config_file("config", "example.conf", { "/etc" });
+ * config.publish();
+ * 
+ * mcfp::config_watcher watcher(config);
+ * watcher.on_change([&config](const std::vector<std::string_view> &changed) {
+ * 	config.publish();
+ * });
+ * 
+ * for (;;)
+ * 	watcher.poll(std::chrono::seconds(1));
+ * @endcode
+ * 
+ * Reloading modifies the config object, other threads should only access
+ * it through @ref mcfp::config::snapshot.
+ */
+
+class config_watcher
+{
+  public:
+	/// @brief The type of the callbacks, called with the names of the options that changed
+	using callback_type = std::function<void(const std::vector<std::string_view> &)>;
+
+	/**
+	 * @brief Watch the file last read by \a config, see @ref mcfp::config::config_file
+	 * Throws an exception if watching failed
+	 * 
+	 * @param config The config object to update
+	 */
+	explicit config_watcher(config &config)
+		: config_watcher(config, config.config_file())
+	{
+	}
+
+	/**
+	 * @brief Watch the file last read by \a config, see @ref mcfp::config::config_file
+	 * If watching failed, the error is returned in \a ec
+	 * 
+	 * @param config The config object to update
+	 * @param ec The variable containing the error status
+	 */
+	config_watcher(config &config, std::error_code &ec)
+		: config_watcher(config, config.config_file(), ec)
+	{
+	}
+
+	/**
+	 * @brief Watch the file \a file and update \a config when it changes
+	 * Throws an exception if watching failed
+	 * 
+	 * @param config The config object to update
+	 * @param file The config file to watch
+	 */
+	config_watcher(config &config, std::filesystem::path file)
+		: m_config(config)
+		, m_file(std::move(file))
+	{
+		std::error_code ec;
+		watch(ec);
+		if (ec)
+			throw std::system_error(ec, m_file.string());
+	}
+
+	/**
+	 * @brief Watch the file \a file and update \a config when it changes
+	 * If watching failed, the error is returned in \a ec
+	 * 
+	 * @param config The config object to update
+	 * @param file The config file to watch
+	 * @param ec The variable containing the error status
+	 */
+	config_watcher(config &config, std::filesystem::path file, std::error_code &ec)
+		: m_config(config)
+		, m_file(std::move(file))
+	{
+		watch(ec);
+	}
+
+	config_watcher(const config_watcher &) = delete;
+	config_watcher &operator=(const config_watcher &) = delete;
+
+	~config_watcher()
+	{
+		if (m_fd >= 0)
+			::close(m_fd);
+	}
+
+	/**
+	 * @brief Register a \a callback, it is called with the names of the
+	 * changed options after each reload that changed at least one option
+	 * 
+	 * @param callback The callback to register
+	 */
+	void on_change(callback_type callback)
+	{
+		m_callbacks.emplace_back(std::move(callback));
+	}
+
+	/**
+	 * @brief Return the file descriptor that becomes readable when the
+	 * file changes, for use in an existing event loop
+	 */
+	int native_handle() const
+	{
+		return m_fd;
+	}
+
+	/**
+	 * @brief Wait at most \a timeout for the file to change, and if it did
+	 * reload it and call the callbacks. Returns true if options changed.
+	 * Throws an exception in case of an error.
+	 * 
+	 * @param timeout The maximum time to wait, zero to check without waiting
+	 * @return bool True if options changed
+	 */
+	bool poll(std::chrono::milliseconds timeout)
+	{
+		std::error_code ec;
+		bool result = poll(timeout, ec);
+		if (ec)
+			throw std::system_error(ec, m_file.string());
+		return result;
+	}
+
+	/**
+	 * @brief Wait at most \a timeout for the file to change, and if it did
+	 * reload it and call the callbacks. Returns true if options changed.
+	 * In case of an error, for instance a syntax error in the new version
+	 * of the file, the options are left untouched and the error is
+	 * returned in \a ec.
+	 * 
+	 * @param timeout The maximum time to wait, zero to check without waiting
+	 * @param ec The variable containing the error status
+	 * @return bool True if options changed
+	 */
+	bool poll(std::chrono::milliseconds timeout, std::error_code &ec)
+	{
+		pollfd pfd{ m_fd, POLLIN, 0 };
+
+		int r = ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+		if (r < 0 and errno != EINTR)
+			ec = std::error_code(errno, std::system_category());
+
+		if (r <= 0 or not file_changed(ec))
+			return false;
+
+		auto changed = m_config.reload_config_file(m_file, ec);
+		if (ec)
+			return false;
+
+		// The file may include other files now
+		watch_included_files(ec);
+
+		if (ec or changed.empty())
+			return false;
+
+		for (auto &callback : m_callbacks)
+			callback(changed);
+
+		return true;
+	}
+
+  private:
+	void watch(std::error_code &ec)
+	{
+		if (m_file.empty())
+		{
+			ec = make_error_code(config_error::config_file_not_found);
+			return;
+		}
+
+		m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_fd < 0)
+		{
+			ec = std::error_code(errno, std::system_category());
+			return;
+		}
+
+		watch_file(m_file, ec);
+
+		// The included files are only known if config read this file
+		if (not ec and m_config.config_file() == m_file)
+			watch_included_files(ec);
+	}
+
+	// Watch the directory containing \a file for changes to \a file
+	void watch_file(const std::filesystem::path &file, std::error_code &ec)
+	{
+		auto dir = file.parent_path();
+		if (dir.empty())
+			dir = ".";
+
+		int wd = ::inotify_add_watch(m_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd < 0)
+			ec = std::error_code(errno, std::system_category());
+		else
+			m_files.emplace_back(wd, file.filename().string());
+	}
+
+	void watch_included_files(std::error_code &ec)
+	{
+		std::vector<int> previous;
+		for (auto &[wd, name] : m_files)
+			previous.emplace_back(wd);
+
+		m_files.resize(1); // the config file itself
+
+		for (auto &file : m_config.included_files())
+		{
+			if (ec)
+				break;
+			watch_file(file, ec);
+		}
+
+		// Files in the same directory share a watch, remove the watches
+		// of directories that no longer contain one of our files
+		std::sort(previous.begin(), previous.end());
+		previous.erase(std::unique(previous.begin(), previous.end()), previous.end());
+
+		for (int wd : previous)
+		{
+			if (std::none_of(m_files.begin(), m_files.end(), [wd](auto &file) { return file.first == wd; }))
+				::inotify_rm_watch(m_fd, wd);
+		}
+	}
+
+	// Read all pending events, return true if one of these was for one of our files
+	bool file_changed(std::error_code &ec)
+	{
+		bool result = false;
+
+		alignas(inotify_event) char buffer[4096];
+
+		for (;;)
+		{
+			auto n = ::read(m_fd, buffer, sizeof(buffer));
+
+			if (n < 0)
+			{
+				if (errno != EAGAIN and errno != EINTR)
+					ec = std::error_code(errno, std::system_category());
+				break;
+			}
+
+			for (char *p = buffer; p < buffer + n;)
+			{
+				auto event = reinterpret_cast<const inotify_event *>(p);
+				if (event->len > 0 and std::find(m_files.begin(), m_files.end(), std::make_pair(event->wd, std::string(event->name))) != m_files.end())
+					result = true;
+				p += sizeof(inotify_event) + event->len;
+			}
+		}
+
+		return result and not ec;
+	}
+
+	config &m_config;
+	std::filesystem::path m_file;
+	int m_fd = -1;
+	std::vector<std::pair<int, std::string>> m_files; // the watched files, as watch descriptor and file name
+	std::vector<callback_type> m_callbacks;
+};
+
+} // namespace mcfp
+
+#endif
@@ -0,0 +1,826 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define CATCH_CONFIG_RUNNER
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#if CATCH22
+# include <catch2/catch.hpp>
+#else
+# include <catch2/catch_all.hpp>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <mcfp/mcfp.hpp>
+
+// --------------------------------------------------------------------
+// Baselines. The mean time of each benchmark can be saved to a file with
+// --save-baseline and later runs can be compared against it with
+// --baseline. Benchmarks that became slower by more than --max-regression
+// percent are reported and make the run fail.
+//
+// A baseline recorded for a Release build is kept in benchmark-baseline.txt,
+// timings depend on the machine of course, so record your own before
+// making changes:
+//
+//     mcfp-bench --save-baseline before.txt
+//     ... change the code, rebuild ...
+//     mcfp-bench --baseline before.txt
+
+std::map<std::string, double> gResults; // mean time in nanoseconds by benchmark name
+
+#if CATCH22
+struct baseline_listener : Catch::TestEventListenerBase
+{
+	using TestEventListenerBase::TestEventListenerBase;
+#else
+struct baseline_listener : Catch::EventListenerBase
+{
+	using EventListenerBase::EventListenerBase;
+#endif
+
+	void benchmarkEnded(Catch::BenchmarkStats<> const &stats) override
+	{
+		gResults[stats.info.name] = stats.mean.point.count();
+	}
+};
+
+CATCH_REGISTER_LISTENER(baseline_listener)
+
+void save_baseline(const std::filesystem::path &file)
+{
+	std::ofstream os(file);
+	os << "# mean time in nanoseconds, benchmark name" << std::endl;
+	for (auto &[name, ns] : gResults)
+		os << std::fixed << std::setprecision(1) << ns << '\t' << name << std::endl;
+}
+
+// Returns the number of regressions
+int compare_baseline(const std::filesystem::path &file, double max_regression)
+{
+	std::ifstream is(file);
+	if (not is.is_open())
+	{
+		std::cerr << "Could not open baseline " << file << std::endl;
+		return 1;
+	}
+
+	int regressions = 0;
+
+	std::cout << std::endl
+			  << std::setw(14) << "baseline ns" << std::setw(14) << "now ns" << std::setw(10) << "change" << "  benchmark" << std::endl;
+
+	for (std::string line; std::getline(is, line);)
+	{
+		auto tab = line.find('\t');
+		if (line.empty() or line.front() == '#' or tab == std::string::npos)
+			continue;
+
+		auto name = line.substr(tab + 1);
+		auto i = gResults.find(name);
+		if (i == gResults.end())
+			continue;
+
+		double before = std::stod(line.substr(0, tab));
+		double change = 100 * (i->second - before) / before;
+		bool regression = change > max_regression;
+
+		std::cout << std::fixed << std::setprecision(1)
+				  << std::setw(14) << before << std::setw(14) << i->second << std::setw(9) << std::showpos << change << std::noshowpos << '%'
+				  << "  " << name << (regression ? "  <-- regression" : "") << std::endl;
+
+		if (regression)
+			++regressions;
+	}
+
+	return regressions;
+}
+
+int main(int argc, char *argv[])
+{
+	Catch::Session session;
+
+	std::string baseline, save;
+	double max_regression = 25;
+
+#if CATCH22
+	using namespace Catch::clara;
+#else
+	using namespace Catch::Clara;
+#endif
+
+	auto cli = session.cli()
+	           | Opt(baseline, "file")["--baseline"]("Compare the results with the baseline in file")
+	           | Opt(save, "file")["--save-baseline"]("Write the results to file, for use as baseline")
+	           | Opt(max_regression, "percent")["--max-regression"]("The slowdown reported as regression, default is 25");
+
+	session.cli(cli);
+
+	int result = session.applyCommandLine(argc, argv);
+	if (result != 0)
+		return result;
+
+	result = session.run();
+
+	if (not save.empty())
+		save_baseline(save);
+
+	if (not baseline.empty() and compare_baseline(baseline, max_regression) > 0)
+		result = 1;
+
+	return result;
+}
+
+// --------------------------------------------------------------------
+// Helpers to create configs with lots of options
+
+template <size_t N>
+const std::array<std::string, N> &option_names()
+{
+	static const std::array<std::string, N> s_names = []()
+	{
+		std::array<std::string, N> names;
+		for (size_t i = 0; i < N; ++i)
+			names[i] = "option-number-" + std::to_string(i);
+		return names;
+	}();
+
+	return s_names;
+}
+
+template <size_t... I>
+void init_config(mcfp::config &config, std::index_sequence<I...>)
+{
+	const auto &names = option_names<sizeof...(I)>();
+	config.init("bench [options]",
+		mcfp::make_option<int>(names[I], static_cast<int>(I), "")...,
+		mcfp::make_option("verbose,v", ""),
+		mcfp::make_option("extract,x", ""),
+		mcfp::make_option<std::string>("file,f", ""));
+}
+
+template <size_t N>
+mcfp::config &make_config()
+{
+	auto &config = mcfp::config::instance();
+	init_config(config, std::make_index_sequence<N>{});
+	return config;
+}
+
+// --------------------------------------------------------------------
+
+template <size_t N>
+void bench_lookup()
+{
+	mcfp::config &config = make_config<N>();
+	const auto &names = option_names<N>();
+
+	BENCHMARK("has, " + std::to_string(N) + " options")
+	{
+		return config.has(names[N - 1]);
+	};
+
+	BENCHMARK("count, " + std::to_string(N) + " options")
+	{
+		return config.count(names[N / 2]);
+	};
+
+	BENCHMARK("get<int>, " + std::to_string(N) + " options")
+	{
+		return config.get<int>(names[N - 1]);
+	};
+
+	auto ref = config.get_ref<int>(names[N - 1]);
+
+	BENCHMARK("option_ref<int>, " + std::to_string(N) + " options")
+	{
+		return *ref;
+	};
+}
+
+TEST_CASE("lookup")
+{
+	bench_lookup<10>();
+	bench_lookup<100>();
+}
+
+// --------------------------------------------------------------------
+
+template <size_t N>
+void bench_short_options()
+{
+	mcfp::config &config = make_config<N>();
+
+	const char *const argv[] = {
+		"bench", "-vvvxf", "file.txt", "-vxvxvxvx", nullptr
+	};
+	int argc = sizeof(argv) / sizeof(char *) - 1;
+
+	BENCHMARK("short option clusters, " + std::to_string(N) + " options")
+	{
+		std::error_code ec;
+		config.parse(argc, argv, ec);
+		return ec;
+	};
+}
+
+TEST_CASE("short options")
+{
+	bench_short_options<10>();
+	bench_short_options<100>();
+}
+
+// --------------------------------------------------------------------
+// Configs with many options use an option_set, a tuple of a thousand
+// options is too much for most compilers
+
+void init_config(mcfp::config &config, const std::vector<std::string> &names)
+{
+	mcfp::option_set options;
+	for (size_t i = 0; i < names.size(); ++i)
+		options.add(mcfp::make_option<int>(names[i], static_cast<int>(i), ""));
+	options.add(mcfp::make_option("verbose,v", ""));
+	options.add(mcfp::make_option("extract,x", ""));
+	options.add(mcfp::make_option<std::string>("file,f", ""));
+
+	config.init("bench [options]", options);
+}
+
+std::vector<std::string> dynamic_option_names(size_t N)
+{
+	const auto &names = option_names<1000>();
+	return { names.begin(), names.begin() + N };
+}
+
+TEST_CASE("lookup, option_set")
+{
+	const size_t N = 1000;
+	const auto names = dynamic_option_names(N);
+
+	mcfp::config config;
+	init_config(config, names);
+
+	BENCHMARK("has, 1000 options")
+	{
+		return config.has(names[N - 1]);
+	};
+
+	BENCHMARK("count, 1000 options")
+	{
+		return config.count(names[N / 2]);
+	};
+
+	BENCHMARK("get<int>, 1000 options")
+	{
+		return config.get<int>(names[N - 1]);
+	};
+}
+
+// --------------------------------------------------------------------
+// Parse a command line setting each option, with some flags and a file
+
+void bench_parse(mcfp::config &config, const std::vector<std::string> &names, const std::string &kind)
+{
+	std::vector<std::string> args{ "bench", "-vx", "--file=input.txt" };
+	for (size_t i = 0; i < names.size(); ++i)
+		args.emplace_back("--" + names[i] + '=' + std::to_string(i));
+
+	std::vector<const char *> argv;
+	for (auto &arg : args)
+		argv.push_back(arg.c_str());
+	argv.push_back(nullptr);
+
+	const int argc = static_cast<int>(args.size());
+
+	BENCHMARK("parse, " + std::to_string(names.size()) + " options" + kind)
+	{
+		std::error_code ec;
+		config.parse(argc, argv.data(), ec);
+		return ec;
+	};
+}
+
+TEST_CASE("parse")
+{
+	{
+		auto &config = make_config<10>();
+		bench_parse(config, dynamic_option_names(10), "");
+	}
+
+	{
+		auto &config = make_config<100>();
+		bench_parse(config, dynamic_option_names(100), "");
+	}
+
+	for (size_t N : { 10, 100, 1000 })
+	{
+		const auto names = dynamic_option_names(N);
+
+		mcfp::config config;
+		init_config(config, names);
+
+		bench_parse(config, names, ", option_set");
+	}
+}
+
+TEST_CASE("parse operands")
+{
+	const size_t N = 100000;
+
+	std::vector<std::string> args{ "bench" };
+	for (size_t i = 0; i < N; ++i)
+		args.emplace_back("/some/path/to/an/input-file-" + std::to_string(i));
+
+	std::vector<const char *> argv;
+	for (auto &arg : args)
+		argv.push_back(arg.c_str());
+	argv.push_back(nullptr);
+
+	auto file = std::filesystem::temp_directory_path() / "mcfp-bench.rsp";
+	{
+		std::ofstream os(file);
+		for (size_t i = 1; i < args.size(); ++i)
+			os << (i % 2 ? "'" + args[i] + "'" : args[i]) << '\n';
+	}
+
+	const std::string response_file = "@" + file.string();
+	const char *const rsp_argv[] = { "bench", response_file.c_str(), nullptr };
+
+	BENCHMARK("parse, 100k operands")
+	{
+		mcfp::config config;
+		config.init("bench", mcfp::make_option("verbose,v", ""));
+
+		std::error_code ec;
+		config.parse(static_cast<int>(args.size()), argv.data(), ec);
+		return config.operands_view().size();
+	};
+
+	BENCHMARK("parse, response file with 100k operands")
+	{
+		mcfp::config config;
+		config.init("bench", mcfp::make_option("verbose,v", ""));
+		config.set_response_files(true);
+
+		std::error_code ec;
+		config.parse(2, rsp_argv, ec);
+		return config.operands_view().size();
+	};
+
+	std::filesystem::remove(file);
+}
+
+TEST_CASE("parse repeated options")
+{
+	for (size_t n : { 100000, 1000000 })
+	{
+		std::vector<std::string> args{ "bench" };
+		for (size_t i = 0; i < n; ++i)
+			args.emplace_back("--input=/some/path/to/an/input-file-" + std::to_string(i));
+
+		std::vector<const char *> argv;
+		for (auto &arg : args)
+			argv.push_back(arg.c_str());
+		argv.push_back(nullptr);
+
+		BENCHMARK("parse, " + std::to_string(n) + " times --input")
+		{
+			mcfp::config config;
+			config.init("bench", mcfp::make_option<std::vector<std::string>>("input,i", ""));
+
+			std::error_code ec;
+			config.parse(static_cast<int>(args.size()), argv.data(), ec);
+			return config.count("input");
+		};
+	}
+}
+
+TEST_CASE("environment")
+{
+	// 1000 options, all set from the environment, in between
+	// 1000 variables that are not bound to an option
+	const size_t N = 1000;
+	const auto names = dynamic_option_names(N);
+
+	std::vector<std::string> vars;
+	for (size_t i = 0; i < N; ++i)
+	{
+		std::string name = names[i];
+		std::replace(name.begin(), name.end(), '-', '_');
+		std::transform(name.begin(), name.end(), name.begin(), [](char ch) { return std::toupper(ch); });
+
+		vars.emplace_back("BENCH_" + name + '=' + std::to_string(i));
+		vars.emplace_back("UNRELATED_VARIABLE_" + std::to_string(i) + "=some value");
+	}
+
+	std::vector<const char *> envp;
+	for (auto &var : vars)
+		envp.push_back(var.c_str());
+	envp.push_back(nullptr);
+
+	mcfp::config config;
+	init_config(config, names);
+
+	// After the first run the options have a value and are not set
+	// again, what remains is the scan of the environment and the lookups
+	BENCHMARK("parse_environment, 1000 options")
+	{
+		std::error_code ec;
+		config.parse_environment("BENCH_", envp.data(), ec);
+		return ec;
+	};
+}
+
+// --------------------------------------------------------------------
+
+TEST_CASE("help")
+{
+	const size_t N = 100;
+	const auto names = dynamic_option_names(N);
+
+	std::vector<std::string> descriptions;
+	for (size_t i = 0; i < N; ++i)
+	{
+		descriptions.emplace_back("The description of option " + std::to_string(i) +
+			", long enough to be wrapped over more than one line when printed at the usual terminal width");
+	}
+
+	mcfp::option_set options;
+	for (size_t i = 0; i < N; ++i)
+		options.add(mcfp::make_option<int>(names[i], static_cast<int>(i), descriptions[i]));
+
+	mcfp::config config;
+	config.init("usage: bench [options] file...", options);
+
+	BENCHMARK("operator<<, 100 options")
+	{
+		std::ostringstream os;
+		os << config;
+		return os.str().length();
+	};
+
+	std::string text;
+	while (text.length() < 4096)
+		text += descriptions[text.length() % N] + (text.length() % 3 ? " " : "\n");
+
+	BENCHMARK("word_wrapper, 4 KB, width 80")
+	{
+		return mcfp::word_wrapper(text, 80).size();
+	};
+}
+
+// --------------------------------------------------------------------
+
+TEST_CASE("typed config")
+{
+	mcfp::typed_config config("bench [options]",
+		mcfp::make_option<"verbose,v">(""),
+		mcfp::make_option<"threads,t", int>(4, ""),
+		mcfp::make_option<"name", std::string>("bench", ""),
+		mcfp::make_option<"input,i", std::vector<std::string>>(""));
+
+	BENCHMARK("typed_config get<\"threads\">")
+	{
+		return config.get<"threads">();
+	};
+
+	BENCHMARK("typed_config get<int>(\"threads\")")
+	{
+		return config.get<int>("threads");
+	};
+}
+
+// --------------------------------------------------------------------
+
+TEST_CASE("get")
+{
+	auto &config = mcfp::config::instance();
+
+	config.init("bench [options]",
+		mcfp::make_option<int>("threads", 4, ""),
+		mcfp::make_option<std::vector<std::string>>("input,i", ""));
+
+	std::vector<std::string> args{ "bench" };
+	for (int i = 0; i < 100; ++i)
+		args.emplace_back("--input=file-with-a-reasonably-long-name-" + std::to_string(i));
+
+	std::vector<const char *> argv;
+	for (auto &arg : args)
+		argv.push_back(arg.c_str());
+
+	config.parse(static_cast<int>(argv.size()), argv.data());
+
+	BENCHMARK("get<int> success")
+	{
+		std::error_code ec;
+		return config.get<int>("threads", ec);
+	};
+
+	BENCHMARK("get<float> type mismatch")
+	{
+		std::error_code ec;
+		return config.get<float>("threads", ec);
+	};
+
+	BENCHMARK("get_if<int> success")
+	{
+		return config.get_if<int>("threads");
+	};
+
+	BENCHMARK("get_if<float> type mismatch")
+	{
+		return config.get_if<float>("threads");
+	};
+
+	BENCHMARK("get<std::vector<std::string>>, 100 values")
+	{
+		return config.get<std::vector<std::string>>("input");
+	};
+
+	BENCHMARK("get_if<std::vector<std::string>>, 100 values")
+	{
+		return config.get_if<std::vector<std::string>>("input");
+	};
+
+#if __cpp_lib_span >= 202002L
+	BENCHMARK("get<std::span<const std::string_view>>, 100 values")
+	{
+		return config.get<std::span<const std::string_view>>("input").size();
+	};
+#endif
+
+	BENCHMARK("has, count")
+	{
+		return config.has("input") + config.count("threads");
+	};
+}
+
+// --------------------------------------------------------------------
+
+TEST_CASE("config file")
+{
+	auto &config = mcfp::config::instance();
+	const auto &names = option_names<100>();
+
+	// A generated config file of a few megabytes, mostly assignments
+	// to single valued options with some comments and a repeated option
+	std::string text;
+	for (size_t i = 0; text.length() < 4 * 1024 * 1024; ++i)
+	{
+		if (i % 10 == 0)
+			text += "# A comment line describing the next set of options\n";
+		else if (i % 10 == 5)
+			text += "file = /a/path/to/some/file-" + std::to_string(i) + ".txt\n";
+		else
+			text += names[i % 100] + " = " + std::to_string(i) + "\n";
+	}
+
+	const std::string size = std::to_string(text.length() / (1024 * 1024)) + " MB";
+
+	BENCHMARK("parse_config_file(std::istream), " + size)
+	{
+		init_config(config, std::make_index_sequence<100>{});
+		std::istringstream is(text);
+		std::error_code ec;
+		config.parse_config_file(is, ec);
+		return ec;
+	};
+
+	BENCHMARK("parse_config_text, " + size)
+	{
+		init_config(config, std::make_index_sequence<100>{});
+		std::error_code ec;
+		config.parse_config_text(text, ec);
+		return ec;
+	};
+
+	auto file = std::filesystem::temp_directory_path() / "mcfp-bench.conf";
+	auto cache = std::filesystem::temp_directory_path() / "mcfp-bench.conf.cache";
+	std::ofstream(file, std::ios::binary) << text;
+
+	BENCHMARK("parse_config_file(std::filesystem::path), " + size)
+	{
+		init_config(config, std::make_index_sequence<100>{});
+		std::error_code ec;
+		config.parse_config_file(file, ec);
+		return ec;
+	};
+
+	BENCHMARK("parse_cached_config_file, " + size)
+	{
+		init_config(config, std::make_index_sequence<100>{});
+		std::error_code ec;
+		config.parse_cached_config_file(file, cache, ec);
+		return ec;
+	};
+
+	std::filesystem::remove(file);
+	std::filesystem::remove(cache);
+}
+
+// --------------------------------------------------------------------
+// Stress test, large config files against large sets of options. The
+// time to parse a file should depend on its size only, not on the
+// number of options.
+
+struct stress_result
+{
+	size_t options;
+	size_t lines;
+	double megabytes;
+	double text_mb_per_s;
+	double file_mb_per_s;
+};
+
+stress_result stress(size_t option_count, size_t line_count)
+{
+	std::vector<std::string> names;
+	for (size_t i = 0; i < option_count; ++i)
+		names.emplace_back("generated-option-" + std::to_string(i));
+
+	mcfp::option_set options;
+	for (auto &name : names)
+		options.add(mcfp::make_option<int>(name, ""));
+	options.add(mcfp::make_option<std::vector<std::string>>("input", ""));
+
+	std::mt19937 rng(option_count);
+	std::uniform_int_distribution<size_t> pick(0, option_count - 1);
+
+	std::string text;
+	for (size_t i = 0; i < line_count; ++i)
+	{
+		if (i % 10 == 0)
+			text += "# comment for line " + std::to_string(i) + "\n";
+		else if (i % 10 == 5)
+			text += "input = /some/path/to/input-file-" + std::to_string(i) + ".txt\n";
+		else
+			text += names[pick(rng)] + " = " + std::to_string(i) + "\n";
+	}
+
+	auto file = std::filesystem::temp_directory_path() / "mcfp-stress.conf";
+	std::ofstream(file, std::ios::binary) << text;
+
+	// best of a few runs, initialising the config is not timed
+	auto best_of = [&](auto &&parse)
+	{
+		std::chrono::duration<double> best{ 1e9 };
+
+		for (int run = 0; run < 5; ++run)
+		{
+			mcfp::config config;
+			config.init("stress", options);
+
+			auto start = std::chrono::steady_clock::now();
+			std::error_code ec = parse(config);
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			REQUIRE_FALSE(ec);
+			best = std::min(best, elapsed);
+		}
+
+		return text.length() / (1024.0 * 1024.0) / best.count();
+	};
+
+	stress_result result{ option_count, line_count, text.length() / (1024.0 * 1024.0) };
+
+	result.text_mb_per_s = best_of([&text](mcfp::config &config)
+	{
+		std::error_code ec;
+		config.parse_config_text(text, ec);
+		return ec;
+	});
+
+	result.file_mb_per_s = best_of([&file](mcfp::config &config)
+	{
+		std::error_code ec;
+		config.parse_config_file(file, ec);
+		return ec;
+	});
+
+	std::filesystem::remove(file);
+
+	return result;
+}
+
+TEST_CASE("stress")
+{
+	std::vector<stress_result> results;
+
+	for (size_t option_count : { 10, 1000, 10000 })
+	{
+		for (size_t line_count : { 100000, 1000000 })
+			results.push_back(stress(option_count, line_count));
+	}
+
+	std::cout << std::endl
+			  << std::setw(8) << "options" << std::setw(10) << "lines" << std::setw(10) << "MB"
+			  << std::setw(14) << "text MB/s" << std::setw(14) << "file MB/s" << std::endl;
+
+	for (auto &r : results)
+	{
+		std::cout << std::fixed << std::setprecision(1)
+				  << std::setw(8) << r.options << std::setw(10) << r.lines << std::setw(10) << r.megabytes
+				  << std::setw(14) << r.text_mb_per_s << std::setw(14) << r.file_mb_per_s << std::endl;
+	}
+
+	// Throughput should not depend on the number of options nor on the size
+	// of the file. Allow for a generous margin, cache effects are real.
+	auto [min, max] = std::minmax_element(results.begin(), results.end(),
+		[](auto &a, auto &b) { return a.text_mb_per_s < b.text_mb_per_s; });
+
+	CHECK(min->text_mb_per_s * 4 > max->text_mb_per_s);
+}
+
+// --------------------------------------------------------------------
+// A config file with hundreds of sections should parse as fast as the
+// same options in a flat file
+
+TEST_CASE("sections")
+{
+	const size_t section_count = 500, key_count = 20;
+
+	mcfp::option_set flat_options, section_options;
+	std::vector<std::string> names;
+	for (size_t s = 0; s < section_count; ++s)
+	{
+		for (size_t k = 0; k < key_count; ++k)
+		{
+			names.emplace_back("section-" + std::to_string(s) + "-key-" + std::to_string(k));
+			names.emplace_back("section-" + std::to_string(s) + ".key-" + std::to_string(k));
+		}
+	}
+
+	for (size_t i = 0; i < names.size(); i += 2)
+	{
+		flat_options.add(mcfp::make_option<int>(names[i], ""));
+		section_options.add(mcfp::make_option<int>(names[i + 1], ""));
+	}
+
+	// Each section is repeated, so that the files contain 1M assignments
+	std::string flat, sections;
+	for (size_t run = 0; run < 100; ++run)
+	{
+		for (size_t s = 0; s < section_count; ++s)
+		{
+			sections += "[section-" + std::to_string(s) + "]\n";
+			for (size_t k = 0; k < key_count; ++k)
+			{
+				flat += "section-" + std::to_string(s) + "-key-" + std::to_string(k) + " = " + std::to_string(k) + "\n";
+				sections += "key-" + std::to_string(k) + " = " + std::to_string(k) + "\n";
+			}
+		}
+	}
+
+	mcfp::config flat_config, section_config;
+
+	BENCHMARK("flat file, 1M assignments")
+	{
+		flat_config.init("flat", flat_options);
+		std::error_code ec;
+		flat_config.parse_config_text(flat, ec);
+		return ec;
+	};
+
+	BENCHMARK("file with sections, 1M assignments")
+	{
+		section_config.init("sections", section_options);
+		std::error_code ec;
+		section_config.parse_config_text(sections, ec);
+		return ec;
+	};
+}
@@ -32,14 +32,59 @@
 # include <catch2/catch_all.hpp>
 #endif
 
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <iomanip>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <tuple>
 
 #include <mcfp/mcfp.hpp>
+#include <mcfp/watcher.hpp>
+
+#if __has_include(<sys/mman.h>)
+# include <csignal>
+# include <pthread.h>
+# include <sys/stat.h>
+#endif
 
 namespace fs = std::filesystem;
 
 std::filesystem::path gTestDir = std::filesystem::current_path();
 
+// Count the heap allocations, for the tests that check there are none.
+// Inlining the delete operators makes gcc warn about free called on
+// memory from operator new.
+
+#if defined(__GNUC__)
+# define NOINLINE __attribute__((noinline))
+#else
+# define NOINLINE
+#endif
+
+std::atomic<size_t> gAllocations{ 0 };
+
+void *operator new(std::size_t size)
+{
+	++gAllocations;
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+NOINLINE void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+NOINLINE void operator delete(void *p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
 int main(int argc, char *argv[])
 {
 	Catch::Session session; // There must be exactly one instance
@@ -422,76 +467,364 @@ TEST_CASE("t_14")
 	CHECK_THROWS_AS(config.parse(argc, argv), std::system_error);
 }
 
-// --------------------------------------------------------------------
+template <size_t... I>
+void init_many(mcfp::config &config, const std::vector<std::string> &names, std::index_sequence<I...>)
+{
+	config.init("test [options]", mcfp::make_option<int>(names[I], static_cast<int>(I), "")...);
+}
 
-TEST_CASE("file_1, * utf::tolerance(0.001)")
+TEST_CASE("t_15")
 {
-	const std::string_view config_file{ R"(
-# This is a test configuration
-aap=1
-noot = 2
-mies = 	
-pi = 3.14
-s = hello, world!
-verbose
-	)" };
+	const size_t N = 64;
 
-	struct membuf : public std::streambuf
+	std::vector<std::string> names;
+	for (size_t i = 0; i < N; ++i)
+		names.emplace_back("option-" + std::to_string(i));
+
+	auto &config = mcfp::config::instance();
+	init_many(config, names, std::make_index_sequence<N>{});
+
+	for (size_t i = 0; i < N; ++i)
 	{
-		membuf(char * text, size_t length)
-		{
-			this->setg(text, text, text + length);
-		}
-	} buffer(const_cast<char *>(config_file.data()), config_file.length());
+		CHECK(config.has(names[i]));
+		CHECK(config.get<int>(names[i]) == static_cast<int>(i));
+	}
 
-	std::istream is(&buffer);
+	CHECK(not config.has("option-64"));
+	CHECK(not config.has("option-"));
+	CHECK(not config.has(""));
+
+	// the first option with a name wins
+	config.init("test [options]",
+		mcfp::make_option<int>("dup", 1, ""),
+		mcfp::make_option<int>("dup", 2, ""));
+	
+	CHECK(config.get<int>("dup") == 1);
+}
+
+TEST_CASE("t_16")
+{
+	const char *const argv[] = {
+		"test", "-vvxfname", "-\xe9", "-v", nullptr
+	};
+	int argc = sizeof(argv) / sizeof(char*) - 1;
 
 	auto &config = mcfp::config::instance();
 
 	config.init(
 		"test [options]",
-		mcfp::make_option<const char*>("aap", ""),
-		mcfp::make_option<int>("noot", ""),
-		mcfp::make_option<std::string>("mies", ""),
-		mcfp::make_option<float>("pi", ""),
-		mcfp::make_option<std::string>("s", ""),
+		mcfp::make_option("verbose,v", ""),
+		mcfp::make_option("extract,x", ""),
+		mcfp::make_option("e-acute,\xe9", ""),
+		mcfp::make_option<std::string>("file,f", ""),
+		mcfp::make_option("other-file,f", ""));
+
+	config.parse(argc, argv);
+
+	CHECK(config.count("verbose") == 3);
+	CHECK(config.count("extract") == 1);
+	CHECK(config.count("e-acute") == 1);
+	CHECK(config.get("file") == "name");
+	CHECK(not config.has("other-file"));
+
+	const char *const argv2[] = {
+		"test", "-vq", nullptr
+	};
+
+	std::error_code ec;
+	config.parse(2, argv2, ec);
+	CHECK(ec == mcfp::config_error::unknown_option);
+}
+
+TEST_CASE("t_17")
+{
+	const char *const argv[] = {
+		"test", "--nr1=42", "-fa", "-fb", "--name", "x", nullptr
+	};
+	int argc = sizeof(argv) / sizeof(char*) - 1;
+
+	auto &config = mcfp::config::instance();
+
+	config.init(
+		"test [options]",
+		mcfp::make_option<int>("nr1", ""),
+		mcfp::make_option<int>("nr2", 2, ""),
+		mcfp::make_option<int>("nr3", ""),
+		mcfp::make_option<const char *>("name", ""),
+		mcfp::make_option<std::vector<std::string>>("file,f", ""),
 		mcfp::make_option("verbose,v", ""));
-	
+
+	auto nr1 = config.get_ref<int>("nr1");
+	auto nr2 = config.get_ref<int>("nr2");
+	auto nr3 = config.get_ref<int>("nr3");
+	auto name = config.get_ref<std::string>("name");
+	auto files = config.get_ref<std::vector<std::string>>("file");
+
+	CHECK(not nr1.has());
+	CHECK(nr2.has());
+	CHECK(*nr2 == 2);
+
+	config.parse(argc, argv);
+
+	CHECK(nr1.has());
+	CHECK(nr1.get() == 42);
+	CHECK(nr1.count() == 1);
+	CHECK(*name == "x");
+	CHECK(name->length() == 1);
+	CHECK(files.count() == 2);
+	CHECK(files->size() == 2);
+	CHECK(files.get().back() == "b");
+
+	CHECK(not nr3.has());
+	CHECK_THROWS_AS(nr3.get(), std::system_error);
+
 	std::error_code ec;
+	config.get_ref<float>("nr1", ec);
+	CHECK(ec == mcfp::config_error::wrong_type_cast);
 
-	config.parse_config_file(is, ec);
+	ec = {};
+	config.get_ref<int>("verbose", ec);
+	CHECK(ec == mcfp::config_error::wrong_type_cast);
 
-	CHECK(not ec);
+	ec = {};
+	config.get_ref<int>("nr4", ec);
+	CHECK(ec == mcfp::config_error::unknown_option);
 
-	CHECK(config.has("aap"));
-	CHECK(config.get<std::string>("aap") == "1");
+	CHECK_THROWS_AS(config.get_ref<std::string>("file"), std::system_error);
+}
 
-	CHECK(config.has("noot"));
-	CHECK(config.get<int>("noot") == 2);
+template <typename C, mcfp::detail::fixed_string Name>
+concept can_get = requires(const C &c) { c.template get<Name>(); };
 
-	CHECK(config.has("pi"));
-	CHECK(std::to_string(config.get<float>("pi")) == std::to_string(3.14));
+template <typename C, mcfp::detail::fixed_string Name>
+concept can_has = requires(const C &c) { c.template has<Name>(); };
 
-	CHECK(config.has("s"));
-	CHECK(config.get<std::string>("s") == "hello, world!");
+TEST_CASE("t_18")
+{
+	const char *const argv[] = {
+		"test", "-vv", "--threads=8", "-ia", "-ib", "--name", "x", "operand", nullptr
+	};
+	int argc = sizeof(argv) / sizeof(char*) - 1;
+
+	mcfp::typed_config config("test [options]",
+		mcfp::make_option<"verbose,v">(""),
+		mcfp::make_option<"threads,t", int>(4, ""),
+		mcfp::make_option<"cache-size", size_t>(1024, ""),
+		mcfp::make_option<"name", const char *>(""),
+		mcfp::make_option<"missing", float>(""),
+		mcfp::make_option<"input,i", std::vector<std::string>>(""),
+		mcfp::make_hidden_option<"debug">(""),
+		mcfp::make_option<int>("runtime", 1, ""));
+
+	CHECK(config.get<"threads">() == 4);
+
+	config.parse(argc, argv);
+
+	CHECK(config.count<"verbose">() == 2);
+	CHECK(config.has<"verbose">());
+	CHECK(not config.has<"debug">());
+
+	static_assert(std::is_same_v<decltype(config.get<"threads">()), const int &>);
+	static_assert(std::is_same_v<decltype(config.get<"name">()), const std::string &>);
+	static_assert(std::is_same_v<decltype(config.get<"input">()), const std::vector<std::string> &>);
 
+	CHECK(config.get<"threads">() == 8);
+	CHECK(config.get<"cache-size">() == 1024);
+	CHECK(config.get<"name">() == "x");
+	CHECK(config.get<"input">().size() == 2);
+	CHECK_THROWS_AS(config.get<"missing">(), std::system_error);
+
+	// misspelled names and flags do not compile
+	using config_type = decltype(config);
+
+	static_assert(can_get<config_type, "threads">);
+	static_assert(not can_get<config_type, "thread">);
+	static_assert(not can_get<config_type, "verbose">);
+	static_assert(can_has<config_type, "verbose">);
+	static_assert(not can_has<config_type, "runtime">);
+
+	// and the runtime interface is still available
+	CHECK(config.get<int>("threads") == 8);
+	CHECK(config.get<int>("runtime") == 1);
 	CHECK(config.has("verbose"));
+	CHECK(config.operands().size() == 1);
+
+	// the options are fixed, also when init is called through the base class
+	mcfp::config &base = config;
+	CHECK_THROWS_AS(base.init("other", mcfp::make_option<int>("threads", "")), std::system_error);
+	CHECK_THROWS_AS(base.init("other", mcfp::option_set{}), std::system_error);
+	CHECK(config.get<"threads">() == 8);
+	CHECK(config.count<"input">() == 2);
 }
 
-TEST_CASE("file_2")
+TEST_CASE("t_19")
 {
+	const char *const argv[] = {
+		"test", "--nr1=42", "-fa", "-fb", "-v", nullptr
+	};
+	int argc = sizeof(argv) / sizeof(char*) - 1;
+
 	auto &config = mcfp::config::instance();
 
-	std::tuple<std::string_view,std::string_view,std::error_code> tests[] = {
-		{ "aap !", "aap", make_error_code(mcfp::config_error::invalid_config_file) },
-		{ "aap=aap", "aap", {} },
-		{ "aap", "aap", make_error_code(mcfp::config_error::missing_argument_for_option) },
-		{ "verbose=1", "verbose", make_error_code(mcfp::config_error::option_does_not_accept_argument) },
-				
+	config.init(
+		"test [options]",
+		mcfp::make_option<int>("nr1", ""),
+		mcfp::make_option<int>("nr2", ""),
+		mcfp::make_option<std::vector<std::string>>("file,f", ""),
+		mcfp::make_option("verbose,v", ""));
+
+	config.parse(argc, argv);
+
+	std::error_code ec;
+
+	auto nr1 = config.get_if<int>("nr1", ec);
+	REQUIRE(nr1 != nullptr);
+	CHECK(*nr1 == 42);
+	CHECK(not ec);
+
+	CHECK(config.get_if<float>("nr1", ec) == nullptr);
+	CHECK(ec == mcfp::config_error::wrong_type_cast);
+
+	ec = {};
+	CHECK(config.get<float>("nr1", ec) == 0);
+	CHECK(ec == mcfp::config_error::wrong_type_cast);
+
+	ec = {};
+	CHECK(config.get_if<int>("nr2", ec) == nullptr);
+	CHECK(ec == mcfp::config_error::option_not_specified);
+
+	ec = {};
+	CHECK(config.get_if<int>("nr3", ec) == nullptr);
+	CHECK(ec == mcfp::config_error::unknown_option);
+
+	ec = {};
+	CHECK(config.get_if<int>("verbose", ec) == nullptr);
+	CHECK(ec == mcfp::config_error::option_not_specified);
+
+	// no copy is made of the values
+	auto files = config.get_if<std::vector<std::string>>("file");
+	REQUIRE(files != nullptr);
+	CHECK(files == config.get_if<const std::vector<std::string>>("file"));
+	CHECK(files->size() == 2);
+}
+
+TEST_CASE("t_20")
+{
+	const char *const argv[] = {
+		"test", "--name=x", "-fa", "-fb", "--nr", "42", nullptr
 	};
+	int argc = sizeof(argv) / sizeof(char*) - 1;
+
+	auto &config = mcfp::config::instance();
+
+	config.init(
+		"test [options]",
+		mcfp::make_option<std::string>("name", ""),
+		mcfp::make_option<std::string>("other", "y", ""),
+		mcfp::make_option<std::string>("missing", ""),
+		mcfp::make_option<int>("nr", ""),
+		mcfp::make_option<std::vector<std::filesystem::path>>("file,f", ""));
+
+	config.parse(argc, argv);
+
+	// views point into argv
+	auto name = config.get<std::string_view>("name");
+	CHECK(name == "x");
+	CHECK(name.data() == argv[1] + 7);
+
+	CHECK(config.get<std::string_view>("other") == "y");
+	CHECK(config.get<std::string_view>("nr") == "42");
+	CHECK(config.get<std::string_view>("file") == "b");
+
+	std::error_code ec;
+	config.get<std::string_view>("missing", ec);
+	CHECK(ec == mcfp::config_error::option_not_specified);
+
+	ec = {};
+	config.get<std::string_view>("unknown", ec);
+	CHECK(ec == mcfp::config_error::unknown_option);
+
+	auto files = config.get<std::span<const std::string_view>>("file");
+	REQUIRE(files.size() == 2);
+	CHECK(files[0] == "a");
+	CHECK(files[0].data() == argv[2] + 2);
+	CHECK(files[1] == "b");
+
+	CHECK(config.get<std::span<const std::string_view>>("nr").size() == 1);
+	CHECK(config.get<std::span<const std::string_view>>("missing").empty());
+}
+
+struct counting_resource : public std::pmr::memory_resource
+{
+	void *do_allocate(size_t bytes, size_t alignment) override
+	{
+		++m_allocations;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void *p, size_t bytes, size_t alignment) override
+	{
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+	size_t m_allocations = 0;
+};
+
+// A memory resource that keeps track of the memory in use
+struct usage_resource : public std::pmr::memory_resource
+{
+	void *do_allocate(size_t bytes, size_t alignment) override
+	{
+		m_in_use += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void *p, size_t bytes, size_t alignment) override
+	{
+		m_in_use -= bytes;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+	size_t m_in_use = 0;
+};
+
+TEST_CASE("t_21")
+{
+	static counting_resource resource;
 
-	for (const auto &[config_file, option, err] : tests)
 	{
+		auto &config = mcfp::config::instance();
+
+		config.set_memory_resource(&resource);
+
+		std::string name = "a-name-that-does-not-fit-in-a-small-string";
+
+		config.init(
+			"test [options]",
+			mcfp::make_option<int>(name, 1, "A description for this option, long enough to need an allocation of its own"),
+			mcfp::make_option<std::string>("another-option-with-a-long-name", "And again a description that is long enough to need an allocation"),
+			mcfp::make_option("verbose,v", "Another description that would need an allocation of its own"));
+
+		// the text is copied, the original may go
+		name = "something else";
+
+		CHECK(resource.m_allocations == 1);
+
+		CHECK(config.has("a-name-that-does-not-fit-in-a-small-string"));
+		CHECK(not config.has("something else"));
+
+		const std::string_view config_file{ "another-option-with-a-long-name = a value from the config file" };
+
 		struct membuf : public std::streambuf
 		{
 			membuf(char * text, size_t length)
@@ -503,79 +836,2290 @@ TEST_CASE("file_2")
 		std::istream is(&buffer);
 
 		std::error_code ec;
-		config.init(
-			"test [options]",
-			mcfp::make_option<const char*>("aap", ""),
-			mcfp::make_option<int>("noot", ""),
-			mcfp::make_option<float>("pi", ""),
-			mcfp::make_option<std::string>("s", ""),
-			mcfp::make_option("verbose,v", ""));
-		
 		config.parse_config_file(is, ec);
+		CHECK(not ec);
 
-		CHECK(ec == err);
+		CHECK(resource.m_allocations == 1);
+		CHECK(config.get<std::string_view>("another-option-with-a-long-name") == "a value from the config file");
 
-		if (ec == std::errc())
-			CHECK(config.has(option));
+		config.set_memory_resource(std::pmr::get_default_resource());
 	}
 }
 
-TEST_CASE("file_3")
+constexpr mcfp::option_spec<> kVerbose{ "verbose,v", "Be verbose, a description that is too long to fit in a small string" };
+constexpr mcfp::option_spec<int> kThreads{ "threads,t", "The number of threads to use for processing the input", "4" };
+constexpr mcfp::option_spec<std::string> kName{ "a-name-that-does-not-fit-in-a-small-string", "A name", "default-name" };
+constexpr mcfp::option_spec<std::vector<std::string>> kInput{ "input,i", "The input files", {}, true };
+
+TEST_CASE("t_22")
 {
+	static counting_resource resource;
+
 	auto &config = mcfp::config::instance();
 
-	config.init(
-		"test [options]",
-		mcfp::make_option<const char*>("aap", ""),
-		mcfp::make_option<int>("noot", ""),
-		mcfp::make_option<std::string>("config", ""));
-	
-	std::error_code ec;
+	config.set_memory_resource(&resource);
+
+	config.init("test [options]",
+		mcfp::make_option(kVerbose),
+		mcfp::make_option(kThreads),
+		mcfp::make_option(kName),
+		mcfp::make_option(kInput));
+
+	CHECK(resource.m_allocations == 0);
+
+	std::ostringstream os;
+	os << config;
+	CHECK(os.str().find("--input") == std::string::npos);
+	CHECK(os.str().find("(=4)") != std::string::npos);
 
 	const char *const argv[] = {
-		"test", "--aap=aap", "--noot=42", "--config=unit-test.conf", nullptr
+		"test", "-vt8", "-ia", "-ib", nullptr
 	};
 	int argc = sizeof(argv) / sizeof(char*) - 1;
 
 	config.parse(argc, argv);
 
-	config.parse_config_file("config", "bla-bla.conf", { gTestDir.string() }, ec);
+	CHECK(config.count("verbose") == 1);
+	CHECK(config.get<int>("threads") == 8);
+	CHECK(config.get("a-name-that-does-not-fit-in-a-small-string") == "default-name");
+	CHECK(config.get<std::vector<std::string>>("input").size() == 2);
 
-	CHECK(not ec);
+	constexpr mcfp::option_spec<int> kBad{ "bad", "", "x" };
+	CHECK_THROWS_AS(mcfp::make_option(kBad), std::system_error);
 
-	CHECK(config.has("aap"));
-	CHECK(config.get<std::string>("aap") == "aap");
+	// flags and options that can be repeated have no default value
+	mcfp::option_spec<> flag{ "flag", "" };
+	flag.m_default_value = "1";
+	CHECK_THROWS_AS(mcfp::make_option(flag), std::system_error);
 
-	CHECK(config.has("noot"));
-	CHECK(config.get<int>("noot") == 42);
+	mcfp::option_spec<std::vector<int>> list{ "list", "" };
+	list.m_default_value = "1";
+	CHECK_THROWS_AS(mcfp::make_option(list), std::system_error);
+
+	config.set_memory_resource(std::pmr::get_default_resource());
 }
 
-	TEST_CASE("file_4")
+TEST_CASE("t_23")
 {
-	auto &config = mcfp::config::instance();
+	const size_t kThreads = 8, kIterations = 250;
 
-	config.init(
-		"test [options]",
-		mcfp::make_option<const char*>("aap", ""),
-		mcfp::make_option<int>("noot", ""),
-		mcfp::make_option<std::string>("config", ""));
-	
-	std::error_code ec;
+	std::vector<std::thread> threads;
+	std::atomic<size_t> errors = 0;
 
-	const char *const argv[] = {
-		"test", "--aap=aap", nullptr
-	};
-	int argc = sizeof(argv) / sizeof(char*) - 1;
+	for (size_t t = 0; t < kThreads; ++t)
+	{
+		threads.emplace_back([t, &errors]()
+		{
+			for (size_t i = 0; i < kIterations; ++i)
+			{
+				mcfp::config config;
+
+				config.init(
+					"test [options]",
+					mcfp::make_option("verbose,v", ""),
+					mcfp::make_option<size_t>("job", ""),
+					mcfp::make_option<std::vector<std::string>>("input,i", ""));
+
+				std::string job = "--job=" + std::to_string(t * kIterations + i);
+
+				const char *const argv[] = {
+					"test", "-vv", job.c_str(), "-ia", "-ib", "operand", nullptr
+				};
+				int argc = sizeof(argv) / sizeof(char*) - 1;
+
+				std::error_code ec;
+				config.parse(argc, argv, ec);
+
+				if (ec or
+					config.count("verbose") != 2 or
+					config.get<size_t>("job") != t * kIterations + i or
+					config.get<std::vector<std::string>>("input").size() != 2 or
+					config.operands().size() != 1)
+				{
+					++errors;
+				}
+			}
+		});
+	}
 
-	config.parse(argc, argv);
+	for (auto &t : threads)
+		t.join();
 
-	config.parse_config_file("config", "unit-test.conf", { gTestDir.string() }, ec);
+	CHECK(errors == 0);
 
-	CHECK(not ec);
+	// and these are independent of the global instance
+	auto &global = mcfp::config::instance();
+	global.init("test", mcfp::make_option<int>("x", 1, ""));
 
-	CHECK(config.has("aap"));
-	CHECK(config.get<std::string>("aap") == "aap");
+	mcfp::config local;
+	local.init("test", mcfp::make_option<int>("x", 2, ""));
 
-	CHECK(config.has("noot"));
-	CHECK(config.get<int>("noot") == 3);
+	CHECK(global.get<int>("x") == 1);
+	CHECK(local.get<int>("x") == 2);
+}
+
+TEST_CASE("t_24")
+{
+	std::shared_ptr<const mcfp::config> snapshot;
+
+	{
+		mcfp::config config;
+
+		config.init(
+			"test [options]",
+			mcfp::make_option("verbose,v", ""),
+			mcfp::make_option<int>("level", 1, ""),
+			mcfp::make_option<std::string>("name", ""),
+			mcfp::make_option<std::vector<std::string>>("input,i", ""));
+
+		std::string args[] = { "test", "-v", "--level=2", "-ia", "operand" };
+		const char *const argv[] = {
+			args[0].c_str(), args[1].c_str(), args[2].c_str(), args[3].c_str(), args[4].c_str(), nullptr
+		};
+		int argc = sizeof(argv) / sizeof(char*) - 1;
+
+		config.parse(argc, argv);
+
+		std::istringstream is("name = aap\ninput = b\n");
+		std::error_code ec;
+		config.parse_config_file(is, ec);
+		CHECK_FALSE(ec);
+
+		snapshot = config.freeze();
+
+		// changes after freezing are not visible in the snapshot
+		const char *const argv2[] = { "test", "-v", "--level=3", "-ic", nullptr };
+		config.parse(4, argv2);
+
+		CHECK(config.count("verbose") == 2);
+		CHECK(config.get<int>("level") == 3);
+		CHECK(snapshot->count("verbose") == 1);
+		CHECK(snapshot->get<int>("level") == 2);
+
+		// the snapshot does not refer to argv either
+		for (auto &arg : args)
+			std::fill(arg.begin(), arg.end(), 'x');
+	}
+
+	CHECK(snapshot->has("verbose"));
+	CHECK(snapshot->get<int>("level") == 2);
+	CHECK(snapshot->get<std::string_view>("level") == "2");
+	CHECK(snapshot->get<std::string>("name") == "aap");
+	CHECK(snapshot->get<std::string_view>("name") == "aap");
+	CHECK(snapshot->get<std::vector<std::string>>("input") == std::vector<std::string>{ "a", "b" });
+#if __cpp_lib_span >= 202002L
+	auto inputs = snapshot->get<std::span<const std::string_view>>("input");
+	CHECK(std::vector<std::string_view>(inputs.begin(), inputs.end()) == std::vector<std::string_view>{ "a", "b" });
+#endif
+	REQUIRE(snapshot->operands().size() == 1);
+	CHECK(snapshot->operands().front() == "operand");
+
+	std::ostringstream os;
+	os << *snapshot;
+	CHECK(os.str().find("--level") != std::string::npos);
+}
+
+TEST_CASE("t_25")
+{
+	// A control thread reinitialises and publishes while readers
+	// access the published snapshots
+	const int kGenerations = 200;
+
+	mcfp::config config;
+	CHECK(config.snapshot() == nullptr);
+
+	auto reparse = [&config](int generation)
+	{
+		config.init(
+			"test [options]",
+			mcfp::make_option<int>("a", ""),
+			mcfp::make_option<int>("b", ""));
+
+		std::string a = "--a=" + std::to_string(generation);
+		std::string b = "--b=" + std::to_string(generation);
+		const char *const argv[] = { "test", a.c_str(), b.c_str(), nullptr };
+		config.parse(3, argv);
+		config.publish();
+	};
+
+	reparse(0);
+
+	std::atomic<bool> done = false;
+	std::atomic<size_t> errors = 0;
+	std::vector<std::thread> readers;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		readers.emplace_back([&]()
+		{
+			int last = 0;
+			while (not done)
+			{
+				auto snapshot = config.snapshot();
+				int a = snapshot->get<int>("a");
+				int b = snapshot->get<int>("b");
+
+				if (a != b or a < last)
+					++errors;
+				last = a;
+			}
+		});
+	}
+
+	for (int generation = 1; generation <= kGenerations; ++generation)
+		reparse(generation);
+
+	done = true;
+	for (auto &t : readers)
+		t.join();
+
+	CHECK(errors == 0);
+	CHECK(config.snapshot()->get<int>("a") == kGenerations);
+}
+
+TEST_CASE("t_27")
+{
+	auto init = [](mcfp::config &config)
+	{
+		config.init(
+			"test [options]",
+			mcfp::make_option<int>("noot", ""),
+			mcfp::make_option<std::string>("s", ""),
+			mcfp::make_option<std::vector<std::string>>("input", ""),
+			mcfp::make_option("verbose,v", ""));
+	};
+
+	std::string text;
+	for (int i = 0; i < 1000; ++i)
+	{
+		text += "# comment " + std::to_string(i) + "\r\n";
+		text += "input = value-" + std::to_string(i) + (i % 2 ? "\n" : "\r\n");
+		if (i % 100 == 0)
+			text += "verbose\n\n";
+	}
+	text += "s = last line without end of line";
+
+	mcfp::config expected;
+	init(expected);
+
+	std::error_code ec;
+	expected.parse_config_text(text, ec);
+	REQUIRE_FALSE(ec);
+
+	std::mt19937 rng(7);
+
+	for (size_t max_chunk : { 1, 2, 3, 17, 100, 5000 })
+	{
+		mcfp::config config;
+		init(config);
+
+		mcfp::config_parser parser(config);
+		std::uniform_int_distribution<size_t> chunk_size(1, max_chunk);
+
+		for (size_t i = 0; i < text.length();)
+		{
+			// use a copy to make sure nothing refers to the chunk afterwards
+			std::string chunk = text.substr(i, chunk_size(rng));
+			i += chunk.length();
+
+			parser.feed(chunk, ec);
+			REQUIRE_FALSE(ec);
+			std::fill(chunk.begin(), chunk.end(), '!');
+		}
+
+		CHECK_FALSE(config.has("s"));
+		parser.finish(ec);
+		REQUIRE_FALSE(ec);
+
+		CHECK(config.count("verbose") == expected.count("verbose"));
+		CHECK(config.get<std::string>("s") == "last line without end of line");
+		CHECK(config.get<std::vector<std::string>>("input") == expected.get<std::vector<std::string>>("input"));
+	}
+
+	// errors are sticky
+	mcfp::config config;
+	init(config);
+
+	mcfp::config_parser parser(config);
+	parser.feed("noot = 1\nno", ec);
+	CHECK_FALSE(ec);
+	parser.feed("ot x\nverbose\n", ec);
+	CHECK(ec == mcfp::config_error::invalid_config_file);
+	parser.feed("verbose\n", ec);
+	CHECK(ec == mcfp::config_error::invalid_config_file);
+	CHECK_THROWS_AS(parser.finish(), std::system_error);
+	CHECK(config.get<int>("noot") == 1);
+	CHECK_FALSE(config.has("verbose"));
+
+	// the std::istream version parses in blocks as well
+	mcfp::config streamed;
+	init(streamed);
+
+	std::istringstream is(text);
+	ec.clear();
+	streamed.parse_config_file(is, ec);
+	CHECK_FALSE(ec);
+	CHECK(streamed.get<std::string>("s") == "last line without end of line");
+	CHECK(streamed.get<std::vector<std::string>>("input") == expected.get<std::vector<std::string>>("input"));
+}
+
+TEST_CASE("t_28")
+{
+	const size_t N = 5000;
+
+	std::vector<std::string> names;
+	for (size_t i = 0; i < N; ++i)
+		names.emplace_back("option-" + std::to_string(i));
+
+	mcfp::option_set options;
+	for (size_t i = 0; i < N; ++i)
+		options.add(mcfp::make_option<int>(names[i], static_cast<int>(i), "An option"));
+	options.add(mcfp::make_option("verbose,v", "Be verbose"));
+	options.add(mcfp::make_option<std::vector<std::string>>("input,i", "Input files"));
+	options.add(mcfp::make_hidden_option<std::string>("secret", ""));
+
+	CHECK(options.size() == N + 3);
+
+	// the set is copied and can be reused
+	mcfp::config config, other;
+	config.init("test [options]", options);
+	other.init("other", options);
+
+	// and the config objects have copies of the names
+	names.assign(names.size(), "overwritten");
+
+	for (size_t i = 0; i < N; ++i)
+		CHECK(config.get<int>("option-" + std::to_string(i)) == static_cast<int>(i));
+
+	const char *const argv[] = {
+		"test", "-vv", "--option-4999=1", "-ia", "--input=b", "--secret=s", nullptr
+	};
+	int argc = sizeof(argv) / sizeof(char*) - 1;
+
+	config.parse(argc, argv);
+
+	std::error_code ec;
+	config.parse_config_text("option-0 = 42\ninput = c\n", ec);
+	CHECK_FALSE(ec);
+
+	CHECK(config.count("verbose") == 2);
+	CHECK(config.get<int>("option-0") == 42);
+	CHECK(config.get<int>("option-4999") == 1);
+	CHECK(config.get<std::vector<std::string>>("input") == std::vector<std::string>{ "a", "b", "c" });
+	CHECK(config.get<std::string>("secret") == "s");
+
+	auto snapshot = config.freeze();
+
+	CHECK(other.get<int>("option-0") == 0);
+	CHECK(other.count("verbose") == 0);
+
+	config.init("test [options]", mcfp::make_option("verbose,v", ""));
+	CHECK(snapshot->get<int>("option-0") == 42);
+	CHECK(snapshot->get<std::vector<std::string>>("input") == std::vector<std::string>{ "a", "b", "c" });
+
+	std::ostringstream os;
+	os << *snapshot;
+	CHECK(os.str().find("--option-4999") != std::string::npos);
+	CHECK(os.str().find("Input files") != std::string::npos);
+	CHECK(os.str().find("secret") == std::string::npos);
+}
+
+struct counted_int
+{
+	static inline int s_conversions = 0;
+	int value;
+};
+
+template <>
+struct mcfp::detail::option_traits<counted_int>
+{
+	using value_type = counted_int;
+
+	static value_type set_value(std::string_view argument, std::error_code &ec)
+	{
+		++counted_int::s_conversions;
+		return { option_traits<int>::set_value(argument, ec) };
+	}
+
+	static std::string to_string(const counted_int &value)
+	{
+		return std::to_string(value.value);
+	}
+};
+
+TEST_CASE("t_29")
+{
+	mcfp::config config;
+
+	config.init(
+		"test [options]",
+		mcfp::make_option<counted_int>("a", counted_int{ 1 }, ""),
+		mcfp::make_option<counted_int>("b", counted_int{ 2 }, ""),
+		mcfp::make_option<counted_int>("c", ""),
+		mcfp::make_option<counted_int>("cmd", ""),
+		mcfp::make_option<std::vector<std::string>>("input", ""),
+		mcfp::make_option("verbose,v", ""));
+
+	const char *const argv[] = { "test", "--cmd=1", nullptr };
+	config.parse(2, argv);
+
+	std::error_code ec;
+	config.parse_config_text("a = 10\nb = 20\ninput = x\ncmd = 5\n", ec);
+	REQUIRE_FALSE(ec);
+
+	auto names = [](std::vector<std::string_view> v)
+	{
+		std::sort(v.begin(), v.end());
+		return v;
+	};
+
+	// only b and the new c change, c and input are converted
+	counted_int::s_conversions = 0;
+	auto changed = config.reload_config_text("a = 10\nb = 21\nc = 3\ninput = x\ncmd = 6\n", ec);
+	CHECK_FALSE(ec);
+	CHECK(names(changed) == std::vector<std::string_view>{ "b", "c" });
+	CHECK(counted_int::s_conversions == 2);
+	CHECK(config.get<counted_int>("a").value == 10);
+	CHECK(config.get<counted_int>("b").value == 21);
+	CHECK(config.get<counted_int>("c").value == 3);
+	CHECK(config.get<counted_int>("cmd").value == 1);
+
+	// removed options return to their default, flags and multiple options
+	changed = config.reload_config_text("c = 3\ninput = x\ninput = y\nverbose\n", ec);
+	CHECK_FALSE(ec);
+	CHECK(names(changed) == std::vector<std::string_view>{ "a", "b", "input", "verbose" });
+	CHECK(config.get<counted_int>("a").value == 1);
+	CHECK(config.get<counted_int>("b").value == 2);
+	CHECK(config.get<std::vector<std::string>>("input") == std::vector<std::string>{ "x", "y" });
+	CHECK(config.count("verbose") == 1);
+
+	// errors leave everything untouched
+	changed = config.reload_config_text("c = 4\nverbose = 1\n", ec);
+	CHECK(ec == mcfp::config_error::option_does_not_accept_argument);
+	CHECK(changed.empty());
+
+	ec.clear();
+	changed = config.reload_config_text("a = 7\nc = x\n", ec);
+	CHECK(ec);
+	CHECK(changed.empty());
+	CHECK(config.get<counted_int>("a").value == 1);
+	CHECK(config.get<counted_int>("c").value == 3);
+
+	ec.clear();
+	changed = config.reload_config_text("", ec);
+	CHECK_FALSE(ec);
+	CHECK(names(changed) == std::vector<std::string_view>{ "c", "input", "verbose" });
+	CHECK_FALSE(config.has("c"));
+	CHECK(config.has("cmd"));
+
+	// a different text for the same value is not a change
+	{
+		mcfp::config other;
+		other.init(
+			"test [options]",
+			mcfp::make_option<int>("size", ""),
+			mcfp::make_option<std::vector<int>>("level", ""),
+			mcfp::make_option<std::string>("name", ""));
+
+		other.parse_config_text("size = 16\nlevel = 1\nname = x\n", ec);
+		REQUIRE_FALSE(ec);
+
+		changed = other.reload_config_text("size = 016\nlevel = 01\nname = x\n", ec);
+		CHECK_FALSE(ec);
+		CHECK(changed.empty());
+		CHECK(other.get<std::string_view>("size") == "016");
+		CHECK(other.get<int>("size") == 16);
+
+		changed = other.reload_config_text("size = 17\nlevel = 01\nlevel = 1\nname = x\n", ec);
+		CHECK_FALSE(ec);
+		CHECK(names(changed) == std::vector<std::string_view>{ "level", "size" });
+	}
+
+	// the default of an option_spec is restored as well
+	{
+		static constexpr mcfp::option_spec<int> kThreads{ "threads", "", "4" };
+
+		mcfp::config other;
+		other.init("test [options]", mcfp::make_option(kThreads));
+
+		other.parse_config_text("threads = 8\n", ec);
+		REQUIRE_FALSE(ec);
+		CHECK(other.get<int>("threads") == 8);
+
+		changed = other.reload_config_text("", ec);
+		CHECK_FALSE(ec);
+		CHECK(names(changed) == std::vector<std::string_view>{ "threads" });
+		CHECK(other.has("threads"));
+		CHECK(other.get<int>("threads") == 4);
+
+		std::ostringstream help;
+		help << other;
+		CHECK(help.str().find("(=4)") != std::string::npos);
+	}
+
+	// reloading again and again does not use more and more memory
+	{
+		usage_resource resource;
+
+		mcfp::config other(&resource);
+		other.init(
+			"test [options]",
+			mcfp::make_option<std::string>("name", ""),
+			mcfp::make_option<std::string>("other", ""));
+
+		std::string padding(500, 'x');
+		auto reload = [&](int i)
+		{
+			// name changes each time, other only every other time
+			other.reload_config_text("name = " + padding + std::to_string(i) + "\nother = " + padding + std::to_string(i / 2) + "\n", ec);
+			CHECK_FALSE(ec);
+		};
+
+		for (int i = 0; i < 10; ++i)
+			reload(i);
+
+		auto in_use = resource.m_in_use;
+
+		for (int i = 10; i < 10000; ++i)
+			reload(i);
+
+		CHECK(resource.m_in_use == in_use);
+		CHECK(other.get<std::string>("other") == padding + "4999");
+		CHECK(other.get<std::string_view>("other") == padding + "4999");
+	}
+}
+
+#if __has_include(<sys/inotify.h>)
+TEST_CASE("t_30")
+{
+	auto dir = std::filesystem::temp_directory_path() / "mcfp-t30";
+	std::filesystem::create_directories(dir);
+
+	auto write = [&dir](std::string_view text)
+	{
+		// write a new version and rename it over the old one, like editors do
+		std::ofstream(dir / "test.conf.new") << text;
+		std::filesystem::rename(dir / "test.conf.new", dir / "test.conf");
+	};
+
+	write("threads = 4\n");
+
+	mcfp::config config;
+	config.init(
+		"test [options]",
+		mcfp::make_option<std::string>("config", ""),
+		mcfp::make_option<int>("threads", 1, ""),
+		mcfp::make_option<int>("cache-size", 100, ""));
+
+	config.parse_config_file("config", "test.conf", { dir.string() });
+	CHECK(config.config_file() == dir / "test.conf");
+	CHECK(config.get<int>("threads") == 4);
+
+	mcfp::config_watcher watcher(config);
+
+	std::vector<std::string_view> changed;
+	watcher.on_change([&changed](const std::vector<std::string_view> &names) { changed = names; });
+
+	CHECK_FALSE(watcher.poll(std::chrono::milliseconds(0)));
+
+	write("threads = 4\ncache-size = 200\n");
+	CHECK(watcher.poll(std::chrono::seconds(5)));
+	CHECK(changed == std::vector<std::string_view>{ "cache-size" });
+	CHECK(config.get<int>("cache-size") == 200);
+
+	// writing in place
+	std::ofstream(dir / "test.conf") << "threads = 8\ncache-size = 200\n";
+	CHECK(watcher.poll(std::chrono::seconds(5)));
+	CHECK(changed == std::vector<std::string_view>{ "threads" });
+	CHECK(config.get<int>("threads") == 8);
+
+	// other files in the directory are ignored
+	std::ofstream(dir / "other.conf") << "threads = 16\n";
+	CHECK_FALSE(watcher.poll(std::chrono::milliseconds(100)));
+
+	// files included by the config file are watched as well, also
+	// when the include was added by a reload
+	std::filesystem::create_directories(dir / "sub");
+	std::ofstream(dir / "sub" / "cache.conf") << "cache-size = 300\n";
+	write("threads = 8\ninclude = sub/cache.conf\n");
+	CHECK(watcher.poll(std::chrono::seconds(5)));
+	CHECK(changed == std::vector<std::string_view>{ "cache-size" });
+	CHECK(config.included_files() == std::vector<std::filesystem::path>{ std::filesystem::canonical(dir / "sub" / "cache.conf") });
+
+	std::ofstream(dir / "sub" / "cache.conf") << "cache-size = 400\n";
+	CHECK(watcher.poll(std::chrono::seconds(5)));
+	CHECK(changed == std::vector<std::string_view>{ "cache-size" });
+	CHECK(config.get<int>("cache-size") == 400);
+
+	// the number of directories watched, as listed by the kernel
+	auto watches = [&watcher]()
+	{
+		std::ifstream fdinfo("/proc/self/fdinfo/" + std::to_string(watcher.native_handle()));
+		size_t result = 0;
+		for (std::string line; std::getline(fdinfo, line);)
+		{
+			if (line.compare(0, 11, "inotify wd:") == 0)
+				++result;
+		}
+		return result;
+	};
+
+	CHECK(watches() == 2);
+
+	// an include that is dropped is no longer watched
+	write("threads = 8\ncache-size = 400\n");
+	CHECK_FALSE(watcher.poll(std::chrono::seconds(5)));
+	CHECK(config.included_files().empty());
+	CHECK(watches() == 1);
+
+	std::ofstream(dir / "sub" / "cache.conf") << "cache-size = 500\n";
+	CHECK_FALSE(watcher.poll(std::chrono::milliseconds(100)));
+	CHECK(config.get<int>("cache-size") == 400);
+
+	// an invalid file is reported, the values stay
+	write("threads = many\n");
+	std::error_code ec;
+	CHECK_FALSE(watcher.poll(std::chrono::seconds(5), ec));
+	CHECK(ec);
+	CHECK(config.get<int>("threads") == 8);
+
+	std::filesystem::remove_all(dir);
+
+	mcfp::config empty;
+	empty.init("test", mcfp::make_option<int>("x", ""));
+	CHECK_THROWS_AS(mcfp::config_watcher(empty), std::system_error);
+}
+#endif
+
+TEST_CASE("t_31")
+{
+	auto dir = std::filesystem::temp_directory_path() / "mcfp-t31";
+	std::filesystem::create_directories(dir);
+
+	const auto file = dir / "test.conf";
+	const auto cache = dir / "test.conf.cache";
+
+	std::filesystem::remove(cache);
+
+	std::ofstream(file) << "threads = 4\nratio = 0.5\nname = aap\nsize = 1\nsize = 2\nverbose\nverbose\nlevel = 3\n";
+
+	auto init = [](mcfp::config &config)
+	{
+		config.init(
+			"test [options]",
+			mcfp::make_option<int>("threads", 1, ""),
+			mcfp::make_option<double>("ratio", ""),
+			mcfp::make_option<std::string>("name", ""),
+			mcfp::make_option<std::vector<int>>("size", ""),
+			mcfp::make_option<counted_int>("level", ""),
+			mcfp::make_option("verbose,v", ""));
+	};
+
+	auto check = [](const mcfp::config &config)
+	{
+		CHECK(config.get<int>("threads") == 4);
+		CHECK(config.get<double>("ratio") == 0.5);
+		CHECK(config.get<std::string>("name") == "aap");
+		CHECK(config.get<std::vector<int>>("size") == std::vector<int>{ 1, 2 });
+		CHECK(config.get<counted_int>("level").value == 3);
+		CHECK(config.get<std::string_view>("threads") == "4");
+		CHECK(config.count("verbose") == 2);
+	};
+
+	std::error_code ec;
+
+	// the first time the cache is written
+	{
+		mcfp::config config;
+		init(config);
+		CHECK_FALSE(config.parse_cached_config_file(file, cache, ec));
+		CHECK_FALSE(ec);
+		CHECK(std::filesystem::exists(cache));
+		check(config);
+	}
+
+	// and then used
+	{
+		mcfp::config config;
+		init(config);
+		CHECK(config.parse_cached_config_file(file, cache, ec));
+		CHECK_FALSE(ec);
+		check(config);
+		CHECK(config.config_file() == file);
+	}
+
+	// command line options still take precedence
+	{
+		mcfp::config config;
+		init(config);
+
+		const char *const argv[] = { "test", "--threads=8", "--size=0", "-v", nullptr };
+		config.parse(4, argv);
+
+		CHECK(config.parse_cached_config_file(file, cache, ec));
+		CHECK(config.get<int>("threads") == 8);
+		CHECK(config.get<std::vector<int>>("size") == std::vector<int>{ 0, 1, 2 });
+		CHECK(config.count("verbose") == 3);
+	}
+
+	// a different set of options invalidates the cache
+	{
+		mcfp::config config;
+		config.init(
+			"test [options]",
+			mcfp::make_option<int>("threads", 1, ""),
+			mcfp::make_option<double>("ratio", ""),
+			mcfp::make_option<std::string>("name", ""),
+			mcfp::make_option<std::vector<int>>("size", ""),
+			mcfp::make_option<counted_int>("level", ""),
+			mcfp::make_option<int>("verbose,v", ""));
+
+		CHECK_FALSE(config.parse_cached_config_file(file, cache, ec));
+		CHECK(ec == mcfp::config_error::missing_argument_for_option);
+		ec.clear();
+	}
+
+	// as does different contents with the same size and modification time
+	{
+		auto mtime = std::filesystem::last_write_time(file);
+		std::ofstream(file) << "threads = 5\nratio = 0.5\nname = aap\nsize = 1\nsize = 2\nverbose\nverbose\nlevel = 3\n";
+		std::filesystem::last_write_time(file, mtime);
+
+		mcfp::config config;
+		init(config);
+		CHECK_FALSE(config.parse_cached_config_file(file, cache, ec));
+		CHECK(config.get<int>("threads") == 5);
+
+		init(config);
+		CHECK(config.parse_cached_config_file(file, cache, ec));
+		CHECK(config.get<int>("threads") == 5);
+	}
+
+	// a damaged cache is ignored and replaced
+	{
+		std::filesystem::resize_file(cache, std::filesystem::file_size(cache) - 3);
+
+		mcfp::config config;
+		init(config);
+		CHECK_FALSE(config.parse_cached_config_file(file, cache, ec));
+		CHECK_FALSE(ec);
+		CHECK(config.get<int>("threads") == 5);
+
+		init(config);
+		CHECK(config.parse_cached_config_file(file, cache, ec));
+	}
+
+	// errors in the config file are reported, and no cache is written
+	{
+		std::ofstream(file) << "threads = many\n";
+		std::filesystem::remove(cache);
+
+		mcfp::config config;
+		init(config);
+		CHECK_FALSE(config.parse_cached_config_file(file, cache, ec));
+		CHECK(ec);
+		CHECK_FALSE(std::filesystem::exists(cache));
+	}
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("t_32")
+{
+	auto dir = std::filesystem::temp_directory_path() / "mcfp-t32";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	std::ofstream(dir / "10-base.conf") << "threads = 4\ninput = a\nverbose\nname = base\nlevel = 1\n";
+	std::ofstream(dir / "20-more.conf") << "threads = 8\ninput = b\ninput = c\nverbose\n";
+	std::ofstream(dir / "30-local.conf") << "name = local\nname = ignored\n";
+	std::ofstream(dir / ".hidden.conf") << "threads = 99\n";
+	std::ofstream(dir / "README") << "not a config file !\n";
+	std::filesystem::create_symlink(dir / "missing", dir / "00-dangling.conf");
+
+	auto init = [](mcfp::config &config)
+	{
+		config.init(
+			"test [options]",
+			mcfp::make_option<int>("threads", 1, ""),
+			mcfp::make_option<int>("level", ""),
+			mcfp::make_option<std::string>("name", ""),
+			mcfp::make_option<std::vector<std::string>>("input", ""),
+			mcfp::make_option("verbose,v", ""));
+	};
+
+	for (size_t thread_count : { 0, 1, 2, 3, 8 })
+	{
+		mcfp::config config;
+		init(config);
+
+		const char *const argv[] = { "test", "--level=7", "--input=x", nullptr };
+		config.parse(3, argv);
+
+		std::error_code ec;
+		config.parse_config_directory(dir, ".conf", thread_count, ec);
+		CHECK_FALSE(ec);
+
+		CHECK(config.get<int>("threads") == 8);
+		CHECK(config.get<int>("level") == 7);
+		CHECK(config.get<std::string>("name") == "local");
+		CHECK(config.get<std::string_view>("name") == "local");
+		CHECK(config.get<std::vector<std::string>>("input") == std::vector<std::string>{ "x", "a", "b", "c" });
+		CHECK(config.count("verbose") == 2);
+
+		// a value replaced in a later fragment is counted once, as with parse_config_file
+		CHECK(config.count("threads") == 1);
+		CHECK(config.count("name") == 1);
+		CHECK(config.count("input") == 4);
+	}
+
+	// Lots of fragments, the outcome must not depend on the number of threads
+	for (int i = 0; i < 100; ++i)
+	{
+		std::ostringstream name;
+		name << "fragment-" << std::setw(3) << std::setfill('0') << i << ".conf";
+
+		std::ofstream os(dir / name.str());
+		if (i % 3 == 0)
+			os << "threads = " << i << '\n';
+		if (i % 7 == 0)
+			os << "name = n" << i << '\n';
+		os << "input = i" << i << "\ninput = j" << i << '\n';
+		if (i % 2)
+			os << "verbose\n";
+	}
+
+	auto load = [&](size_t thread_count)
+	{
+		auto config = std::make_unique<mcfp::config>();
+		init(*config);
+
+		std::error_code ec;
+		config->parse_config_directory(dir, ".conf", thread_count, ec);
+		CHECK_FALSE(ec);
+		return config;
+	};
+
+	auto sequential = load(1);
+	CHECK(sequential->get<int>("threads") == 99);
+	CHECK(sequential->get<std::string>("name") == "n98");
+	CHECK(sequential->get<std::vector<std::string>>("input").size() == 3 + 200);
+	CHECK(sequential->count("verbose") == 2 + 50);
+
+	for (size_t thread_count : { 2, 4, 16 })
+	{
+		auto parallel = load(thread_count);
+		CHECK(parallel->get<int>("threads") == sequential->get<int>("threads"));
+		CHECK(parallel->get<std::string>("name") == sequential->get<std::string>("name"));
+		CHECK(parallel->get<std::vector<std::string>>("input") == sequential->get<std::vector<std::string>>("input"));
+		CHECK(parallel->count("verbose") == sequential->count("verbose"));
+	}
+
+	// an error in one of the fragments changes nothing
+	std::ofstream(dir / "50-bad.conf") << "threads = many\n";
+
+	mcfp::config config;
+	init(config);
+
+	std::error_code ec;
+	config.parse_config_directory(dir, ec);
+	CHECK(ec);
+	CHECK(config.get<int>("threads") == 1);
+	CHECK_FALSE(config.has("input"));
+
+	// a missing directory is not an error
+	ec.clear();
+	config.parse_config_directory(dir / "missing", ec);
+	CHECK_FALSE(ec);
+
+	// but one that cannot be read is
+	ec.clear();
+	config.parse_config_directory(dir / "50-bad.conf", ec);
+	CHECK(ec == std::errc::not_a_directory);
+
+	std::filesystem::create_directory(dir / "locked");
+	std::ofstream(dir / "locked" / "a.conf") << "threads = 2\n";
+	std::filesystem::permissions(dir / "locked", std::filesystem::perms::none);
+
+	std::error_code locked_ec;
+	std::filesystem::directory_iterator locked(dir / "locked", locked_ec);
+	if (locked_ec) // a privileged user can still read it
+	{
+		ec.clear();
+		config.parse_config_directory(dir / "locked", ec);
+		CHECK(ec == locked_ec);
+		CHECK(config.get<int>("threads") == 1);
+	}
+
+	std::filesystem::permissions(dir / "locked", std::filesystem::perms::owner_all);
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("t_33")
+{
+	auto dir = std::filesystem::temp_directory_path() / "mcfp-t33";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir / "sub");
+	std::filesystem::create_directories(dir / "conf.d");
+
+	std::ofstream(dir / "common.conf") << "threads = 4\ninput = common\nverbose\n";
+	std::ofstream(dir / "sub" / "extra.conf") << "input = extra\ninclude = ../common.conf  \n";
+	std::ofstream(dir / "main.conf") << "name = main\ninclude = common.conf\ninclude = sub/extra.conf\nthreads = 8\n";
+
+	auto init = [](mcfp::config &config)
+	{
+		config.init(
+			"test [options]",
+			mcfp::make_option<int>("threads", 1, ""),
+			mcfp::make_option<std::string>("name", ""),
+			mcfp::make_option<std::vector<std::string>>("input", ""),
+			mcfp::make_option("verbose,v", ""));
+	};
+
+	{
+		mcfp::config config;
+		init(config);
+
+		std::error_code ec;
+		config.parse_config_file(dir / "main.conf", ec);
+		CHECK_FALSE(ec);
+
+		CHECK(config.get<int>("threads") == 4);
+		CHECK(config.get<std::string>("name") == "main");
+		CHECK(config.get<std::vector<std::string>>("input") == std::vector<std::string>{ "common", "extra", "common" });
+		CHECK(config.count("verbose") == 2);
+	}
+
+	// fragments sharing an include
+	for (int i = 0; i < 10; ++i)
+		std::ofstream(dir / "conf.d" / ("fragment-" + std::to_string(i) + ".conf")) << "include = ../common.conf\n";
+
+	{
+		mcfp::config config;
+		init(config);
+
+		std::error_code ec;
+		config.parse_config_directory(dir / "conf.d", ".conf", 4, ec);
+		CHECK_FALSE(ec);
+		CHECK(config.get<int>("threads") == 4);
+		CHECK(config.get<std::vector<std::string>>("input").size() == 10);
+		CHECK(config.count("verbose") == 10);
+	}
+
+	// included files are read once, until they change
+	{
+		mcfp::detail::include_cache cache;
+
+		std::error_code ec;
+		auto path = std::filesystem::canonical(dir / "common.conf");
+		auto a = cache.get(path, ec);
+		auto b = cache.get(path, ec);
+		CHECK_FALSE(ec);
+		REQUIRE(a);
+		CHECK(a == b);
+		CHECK(a->m_tokens.size() == 3);
+
+		std::ofstream(dir / "common.conf") << "threads = 5\n";
+		auto c = cache.get(path, ec);
+		CHECK_FALSE(ec);
+		REQUIRE(c);
+		CHECK(c != a);
+		CHECK(c->m_tokens.size() == 1);
+		CHECK(a->m_tokens.size() == 3);
+
+		// the old version does not depend on the file, which was truncated
+		CHECK(a->m_tokens[1].m_name == "input");
+		CHECK(a->m_tokens[1].m_value == "common");
+
+		// a file that can not be read is not cached
+		CHECK_FALSE(cache.get(dir / "missing.conf", ec));
+		CHECK(ec);
+		ec.clear();
+
+		std::ofstream(dir / "common.conf") << "threads = 4\ninput = common\nverbose\n";
+	}
+
+	// the cache depends on the included files as well
+	{
+		auto cache_file = dir / "main.cache";
+
+		mcfp::config config;
+		init(config);
+
+		std::error_code ec;
+		CHECK_FALSE(config.parse_cached_config_file(dir / "main.conf", cache_file, ec));
+		CHECK_FALSE(ec);
+
+		mcfp::config cached;
+		init(cached);
+		CHECK(cached.parse_cached_config_file(dir / "main.conf", cache_file, ec));
+		CHECK_FALSE(ec);
+		CHECK(cached.get<std::vector<std::string>>("input") == std::vector<std::string>{ "common", "extra", "common" });
+
+		std::ofstream(dir / "sub" / "extra.conf") << "input = changed\n";
+
+		mcfp::config changed;
+		init(changed);
+		CHECK_FALSE(changed.parse_cached_config_file(dir / "main.conf", cache_file, ec));
+		CHECK_FALSE(ec);
+		CHECK(changed.get<std::vector<std::string>>("input") == std::vector<std::string>{ "common", "changed" });
+	}
+
+	// errors
+	auto parse = [&](const std::filesystem::path &file)
+	{
+		mcfp::config config;
+		init(config);
+
+		std::error_code ec;
+		config.parse_config_file(file, ec);
+		return ec;
+	};
+
+	std::ofstream(dir / "a.conf") << "include = b.conf\n";
+	std::ofstream(dir / "b.conf") << "threads = 2\ninclude = " << (dir / "a.conf").string() << "\n";
+	std::ofstream(dir / "self.conf") << "include = ./self.conf\n";
+	std::ofstream(dir / "missing.conf") << "include = does-not-exist.conf\n";
+	std::ofstream(dir / "empty.conf") << "include = \n";
+
+	CHECK(parse(dir / "a.conf") == mcfp::config_error::include_cycle);
+	CHECK(parse(dir / "b.conf") == mcfp::config_error::include_cycle);
+	CHECK(parse(dir / "self.conf") == mcfp::config_error::include_cycle);
+	CHECK(parse(dir / "missing.conf") == mcfp::config_error::config_file_not_found);
+	CHECK(parse(dir / "empty.conf") == mcfp::config_error::missing_argument_for_option);
+
+	for (int i = 0; i < 20; ++i)
+		std::ofstream(dir / ("deep-" + std::to_string(i) + ".conf")) << "include = deep-" << (i + 1) << ".conf\n";
+	std::ofstream(dir / "deep-20.conf") << "threads = 20\n";
+
+	CHECK(parse(dir / "deep-0.conf") == mcfp::config_error::include_depth_exceeded);
+	CHECK_FALSE(parse(dir / "deep-10.conf"));
+
+	// an option called include takes precedence
+	{
+		mcfp::config config;
+		config.init(
+			"test [options]",
+			mcfp::make_option<std::string>("include", ""));
+
+		std::error_code ec;
+		config.parse_config_text("include = common.conf\n", ec);
+		CHECK_FALSE(ec);
+		CHECK(config.get<std::string>("include") == "common.conf");
+	}
+}
+
+TEST_CASE("t_34")
+{
+	auto init = [](mcfp::config &config)
+	{
+		config.init(
+			"test [options]",
+			mcfp::make_option<std::string>("name", ""),
+			mcfp::make_option<int>("cache.size", 1, ""),
+			mcfp::make_option("cache.enabled", ""),
+			mcfp::make_option<int>("server.http.port", ""),
+			mcfp::make_option<std::vector<std::string>>("server.http.host", ""));
+	};
+
+	const std::string_view text =
+		"name = top\n"
+		"[cache]\n"
+		"size = 10\n"
+		"enabled\n"
+		"\n"
+		"  [ server.http ]  \n"
+		"port = 8080\n"
+		"host = a\n"
+		"host = b\n"
+		"[cache]\n"
+		"enabled\n";
+
+	{
+		mcfp::config config;
+		init(config);
+
+		std::error_code ec;
+		config.parse_config_text(text, ec);
+		CHECK_FALSE(ec);
+
+		CHECK(config.get<std::string>("name") == "top");
+		CHECK(config.get<int>("cache.size") == 10);
+		CHECK(config.count("cache.enabled") == 2);
+		CHECK(config.get<int>("server.http.port") == 8080);
+		CHECK(config.get<std::vector<std::string>>("server.http.host") == std::vector<std::string>{ "a", "b" });
+	}
+
+	// the section is kept between the pieces of a file
+	{
+		mcfp::config config;
+		init(config);
+
+		mcfp::config_parser parser(config);
+		for (char ch : text)
+			parser.feed({ &ch, 1 });
+		parser.finish();
+
+		CHECK(config.get<int>("cache.size") == 10);
+		CHECK(config.count("cache.enabled") == 2);
+		CHECK(config.get<int>("server.http.port") == 8080);
+	}
+
+	{
+		mcfp::config config;
+		init(config);
+
+		std::istringstream is(std::string{ text });
+
+		std::error_code ec;
+		config.parse_config_file(is, ec);
+		CHECK_FALSE(ec);
+		CHECK(config.get<std::vector<std::string>>("server.http.host") == std::vector<std::string>{ "a", "b" });
+	}
+
+	// the command line takes precedence
+	{
+		mcfp::config config;
+		init(config);
+
+		const char *const argv[] = { "test", "--cache.size=5", nullptr };
+		config.parse(2, argv);
+
+		std::error_code ec;
+		config.parse_config_text(text, ec);
+		CHECK_FALSE(ec);
+		CHECK(config.get<int>("cache.size") == 5);
+	}
+
+	// names are only found in their own section
+	for (std::string_view bad : { "[cache]\nport = 1\n", "size = 1\n", "[server]\nport = 1\n", "[cache.size]\nsize = 1\n" })
+	{
+		mcfp::config config;
+		init(config);
+
+		std::error_code ec;
+		config.parse_config_text(bad, ec);
+		CHECK(ec == mcfp::config_error::unknown_option);
+	}
+
+	for (std::string_view bad : { "[]\n", "[cache\n", "[cache] size = 1\n", "[ca che]\n", "[cache]]\n", "[server]\nhttp.port = 1\n" })
+	{
+		mcfp::config config;
+		init(config);
+
+		std::error_code ec;
+		config.parse_config_text(bad, ec);
+		CHECK(ec == mcfp::config_error::invalid_config_file);
+	}
+
+	// included files start outside any section
+	{
+		auto dir = std::filesystem::temp_directory_path() / "mcfp-t34";
+		std::filesystem::remove_all(dir);
+		std::filesystem::create_directories(dir);
+
+		std::ofstream(dir / "included.conf") << "name = included\n[server.http]\nport = 1\n";
+		std::ofstream(dir / "main.conf") << "[cache]\ninclude = included.conf\nsize = 3\n";
+
+		mcfp::config config;
+		init(config);
+
+		std::error_code ec;
+		config.parse_config_file(dir / "main.conf", ec);
+		CHECK_FALSE(ec);
+		CHECK(config.get<std::string>("name") == "included");
+		CHECK(config.get<int>("server.http.port") == 1);
+		CHECK(config.get<int>("cache.size") == 3);
+	}
+
+	// many sections
+	{
+		mcfp::option_set options;
+		std::vector<std::string> names;
+		for (int i = 0; i < 500; ++i)
+			names.push_back("section-" + std::to_string(i) + ".value");
+		for (auto &name : names)
+			options.add(mcfp::make_option<int>(name, ""));
+
+		mcfp::config config;
+		config.init("test", options);
+
+		std::string file;
+		for (int i = 0; i < 500; ++i)
+			file += "[section-" + std::to_string(i) + "]\nvalue = " + std::to_string(i) + "\n";
+
+		std::error_code ec;
+		config.parse_config_text(file, ec);
+		CHECK_FALSE(ec);
+
+		for (int i = 0; i < 500; ++i)
+			CHECK(config.get<int>(names[i]) == i);
+	}
+}
+
+TEST_CASE("t_35")
+{
+	mcfp::config config;
+	config.init(
+		"test [options]",
+		mcfp::make_option<int>("threads", 1, ""),
+		mcfp::make_option<std::vector<int>>("level", ""),
+		mcfp::make_option<int>("cache.size", ""),
+		mcfp::make_option("verbose,v", ""));
+
+	const std::string_view text =
+		"threads = 4\n"
+		"threads = four\n"
+		"verbose = yes\r\n"
+		"  unknown = 1\n"
+		"level = 1\n"
+		"level = x\n"
+		"!syntax error\n"
+		"threads\n"
+		"[cache]\n"
+		"size = 10\n"
+		"[broken\n"
+		"size = big\n"
+		"include = not-followed.conf\n";
+
+	std::vector<std::tuple<size_t, size_t, std::error_code>> errors;
+	auto n = config.validate_config_text(text, [&errors](size_t line, size_t column, std::error_code ec)
+	{
+		errors.emplace_back(line, column, ec);
+	});
+
+	using E = mcfp::config_error;
+	const std::vector<std::tuple<size_t, size_t, std::error_code>> expected{
+		{ 2, 11, std::make_error_code(std::errc::invalid_argument) },
+		{ 3, 1, make_error_code(E::option_does_not_accept_argument) },
+		{ 4, 3, make_error_code(E::unknown_option) },
+		{ 6, 9, std::make_error_code(std::errc::invalid_argument) },
+		{ 7, 1, make_error_code(E::invalid_config_file) },
+		{ 8, 1, make_error_code(E::missing_argument_for_option) },
+		{ 11, 8, make_error_code(E::invalid_config_file) },
+		{ 12, 8, std::make_error_code(std::errc::invalid_argument) },
+	};
+
+	CHECK(n == expected.size());
+	CHECK(errors == expected);
+
+	// nothing was changed
+	CHECK(config.get<int>("threads") == 1);
+	CHECK_FALSE(config.has("cache.size"));
+
+	// a valid file
+	CHECK(config.validate_config_text("threads = 2\nverbose\n[cache]\nsize = 1\n", [](size_t, size_t, std::error_code) {}) == 0);
+
+	config.set_ignore_unknown(true);
+	CHECK(config.validate_config_text("unknown = 1\n", [](size_t, size_t, std::error_code) {}) == 0);
+}
+
+TEST_CASE("t_36")
+{
+	// A config object that allocates from a fixed buffer, anything
+	// beyond that buffer is counted
+	alignas(std::max_align_t) static char buffer[8 * 1024 * 1024];
+	counting_resource upstream;
+	std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), &upstream);
+
+	mcfp::config config(&resource);
+	config.init(
+		"test [options] files...",
+		mcfp::make_option("verbose,v", ""),
+		mcfp::make_option("quiet,q", ""),
+		mcfp::make_option<int>("threads,j", 1, ""),
+		mcfp::make_option<float>("scale", ""),
+		mcfp::make_option<std::string>("name", ""));
+
+	const size_t N = 100000;
+
+	std::vector<std::string> files;
+	for (size_t i = 0; i < N; ++i)
+		files.emplace_back("file-" + std::to_string(i));
+
+	std::vector<const char *> argv{ "test", "-vvq", "--threads=8", "--scale", "0.5" };
+	for (auto &file : files)
+		argv.emplace_back(file.c_str());
+	argv.insert(argv.begin() + 2, "-j4");
+	argv.emplace_back("--");
+	argv.emplace_back("-not-an-option");
+	argv.emplace_back(nullptr);
+
+	std::error_code ec;
+
+	// nothing may be allocated from the default resource or the heap either
+	counting_resource fallback;
+	auto default_resource = std::pmr::set_default_resource(&fallback);
+	auto allocations = gAllocations.load();
+
+	config.parse(static_cast<int>(argv.size() - 1), argv.data(), ec);
+
+	CHECK(gAllocations.load() == allocations);
+	std::pmr::set_default_resource(default_resource);
+
+	CHECK(upstream.m_allocations == 0);
+	CHECK(fallback.m_allocations == 0);
+	CHECK_FALSE(ec);
+
+	CHECK(config.count("verbose") == 2);
+	CHECK(config.has("quiet"));
+	CHECK(config.get<int>("threads") == 8);
+	CHECK(config.get<float>("scale") == 0.5f);
+	CHECK_FALSE(config.has("name"));
+
+	// the operands are the argv strings themselves
+	auto &operands = config.operands_view();
+	REQUIRE(operands.size() == N + 1);
+	for (size_t i = 0; i < N; ++i)
+		CHECK(operands[i].data() == files[i].c_str());
+	CHECK(operands[N] == "-not-an-option");
+
+	// strings are still available
+	CHECK(config.operands().size() == N + 1);
+	CHECK(config.operands().front() == "file-0");
+	CHECK(config.operands().back() == "-not-an-option");
+
+	// a snapshot has its own copy
+	auto snapshot = config.freeze();
+	REQUIRE(snapshot->operands_view().size() == N + 1);
+	CHECK(snapshot->operands_view()[1] == "file-1");
+	CHECK(snapshot->operands_view()[1].data() != files[1].c_str());
+
+	// a string option is fine, but may allocate
+	const char *const argv2[] = { "test", "--name=x", "more", nullptr };
+	config.parse(3, argv2, ec);
+	CHECK_FALSE(ec);
+	CHECK(config.get<std::string>("name") == "x");
+	CHECK(config.operands().size() == N + 2);
+	CHECK(config.operands().back() == "more");
+
+	// operands remains valid when argv is gone
+	{
+		mcfp::config other;
+		other.init("test [options] files...", mcfp::make_option("verbose,v", ""));
+
+		{
+			std::vector<std::string> args{ "test", "-v", "first", "second" };
+			std::vector<const char *> argv3;
+			for (auto &arg : args)
+				argv3.emplace_back(arg.c_str());
+
+			other.parse(static_cast<int>(argv3.size()), argv3.data(), ec);
+			CHECK_FALSE(ec);
+		}
+
+		CHECK(other.operands() == std::vector<std::string>{ "first", "second" });
+	}
+
+	// parsing again and again uses memory in proportion to the operands
+	{
+		usage_resource usage;
+		mcfp::config other(&usage);
+		other.init("test [options] files...", mcfp::make_option("verbose,v", ""));
+
+		const char *const argv4[] = { "test", "-v", "operand", nullptr };
+		const size_t M = 4000;
+		for (size_t i = 0; i < M; ++i)
+			other.parse(3, argv4, ec);
+
+		CHECK_FALSE(ec);
+		CHECK(other.operands_view().size() == M);
+		CHECK(usage.m_in_use < 256 * M);
+	}
+
+	// options that can be repeated keep their values in a std::vector,
+	// which does allocate, but only once for all values
+	{
+		mcfp::config other(&resource);
+		other.init("test [options]", mcfp::make_option<std::vector<int>>("level,l", ""));
+
+		const char *const argv5[] = { "test", "-l1", "-l2", "--level=3", nullptr };
+
+		allocations = gAllocations.load();
+		other.parse(4, argv5, ec);
+		CHECK(gAllocations.load() - allocations <= 2);
+
+		CHECK_FALSE(ec);
+		CHECK(other.get<std::vector<int>>("level") == std::vector<int>{ 1, 2, 3 });
+	}
+}
+
+TEST_CASE("t_37")
+{
+	auto dir = std::filesystem::temp_directory_path() / "mcfp-t37";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	auto init = [](mcfp::config &config)
+	{
+		config.init(
+			"test [options] files...",
+			mcfp::make_option("verbose,v", ""),
+			mcfp::make_option<int>("threads,j", 1, ""),
+			mcfp::make_option<std::string>("name", ""),
+			mcfp::make_option<std::vector<std::string>>("input,i", ""));
+		config.set_response_files(true);
+	};
+
+	const std::string args =
+		"-v --threads 4\n"
+		"--name='a name with spaces'\n"
+		"  plain\t\"double \\\"quoted\\\" \\$x \\n\"  'single \\ \"x\"'\r\n"
+		"mixed'  'quo\"te\"s back\\ slash\\\n"
+		"joined -i\n"
+		"input-file\n"
+		"''\n"
+		"-- -j";
+
+	std::ofstream(dir / "args.rsp", std::ios::binary) << args;
+
+	{
+		mcfp::config config;
+		init(config);
+
+		const std::string file = "@" + (dir / "args.rsp").string();
+		const char *const argv[] = { "test", "first", file.c_str(), "last", "@not-expanded", nullptr };
+
+		std::error_code ec;
+		config.parse(5, argv, ec);
+		CHECK_FALSE(ec);
+
+		CHECK(config.count("verbose") == 1);
+		CHECK(config.get<int>("threads") == 4);
+		CHECK(config.get<std::string>("name") == "a name with spaces");
+		CHECK(config.get<std::vector<std::string>>("input") == std::vector<std::string>{ "input-file" });
+
+		const std::vector<std::string> operands{
+			"first", "plain", "double \"quoted\" $x \\n", "single \\ \"x\"", "mixed  quotes", "back slashjoined", "", "-j", "last", "@not-expanded"
+		};
+		CHECK(config.operands() == operands);
+
+		// the file itself is left alone
+		std::ifstream is(dir / "args.rsp", std::ios::binary);
+		CHECK(std::string{ std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>() } == args);
+
+		// a snapshot does not refer to the response file
+		auto snapshot = config.freeze();
+		config.init("empty");
+		CHECK(snapshot->get<std::string>("name") == "a name with spaces");
+		CHECK(snapshot->operands()[2] == "double \"quoted\" $x \\n");
+	}
+
+	// an option may get its argument from the next argument on the command line
+	{
+		std::ofstream(dir / "option.rsp") << "-v --name";
+
+		mcfp::config config;
+		init(config);
+
+		const std::string file = "@" + (dir / "option.rsp").string();
+		const char *const argv[] = { "test", file.c_str(), "@x", nullptr };
+
+		std::error_code ec;
+		config.parse(3, argv, ec);
+		CHECK_FALSE(ec);
+		CHECK(config.get<std::string>("name") == "@x");
+	}
+
+	// response files are off by default, an argument starting with @ is an operand
+	{
+		mcfp::config config;
+		config.init("test [options] packages...", mcfp::make_option("verbose,v", ""));
+
+		const std::string file = "@" + (dir / "args.rsp").string();
+		const char *const argv[] = { "test", "@scope/pkg", "-v", "@user", file.c_str(), nullptr };
+
+		std::error_code ec;
+		config.parse(5, argv, ec);
+		CHECK_FALSE(ec);
+		CHECK(config.has("verbose"));
+		CHECK(config.operands() == std::vector<std::string>{ "@scope/pkg", "@user", file });
+	}
+
+	// a closing quote may be the last character of the file
+	for (std::string_view text : { "--name \"hello world\"", "--name 'hello world'", "--name=\"hello world\"" })
+	{
+		std::ofstream(dir / "eof.rsp", std::ios::binary) << text;
+
+		mcfp::config config;
+		init(config);
+
+		const std::string file = "@" + (dir / "eof.rsp").string();
+		const char *const argv[] = { "test", file.c_str(), nullptr };
+
+		std::error_code ec;
+		config.parse(2, argv, ec);
+		CHECK_FALSE(ec);
+		CHECK(config.get<std::string>("name") == "hello world");
+	}
+
+	// errors
+	for (std::string_view bad : { "'unterminated", "\"unterminated", "\"unterminated\\", "trailing\\", "--name" })
+	{
+		std::ofstream(dir / "bad.rsp", std::ios::binary) << bad;
+
+		mcfp::config config;
+		init(config);
+
+		const std::string file = "@" + (dir / "bad.rsp").string();
+		const char *const argv[] = { "test", file.c_str(), nullptr };
+
+		std::error_code ec;
+		config.parse(2, argv, ec);
+		CHECK(ec == (bad == "--name" ? mcfp::config_error::missing_argument_for_option : mcfp::config_error::invalid_response_file));
+	}
+
+	{
+		mcfp::config config;
+		init(config);
+
+		const std::string file = "@" + (dir / "missing.rsp").string();
+		const char *const argv[] = { "test", file.c_str(), nullptr };
+
+		std::error_code ec;
+		config.parse(2, argv, ec);
+		CHECK(ec == mcfp::config_error::config_file_not_found);
+	}
+
+	// a million arguments
+	{
+		const size_t N = 1000000;
+
+		{
+			std::ofstream os(dir / "large.rsp");
+			for (size_t i = 0; i < N; ++i)
+				os << (i % 2 ? "-i input-" : "operand-") << i << '\n';
+		}
+
+		mcfp::config config;
+		init(config);
+
+		const std::string file = "@" + (dir / "large.rsp").string();
+		const char *const argv[] = { "test", file.c_str(), nullptr };
+
+		std::error_code ec;
+		config.parse(2, argv, ec);
+		CHECK_FALSE(ec);
+
+		CHECK(config.operands_view().size() == N / 2);
+		CHECK(config.operands_view().back() == "operand-" + std::to_string(N - 2));
+		CHECK(config.count("input") == N / 2);
+	}
+
+	std::filesystem::remove_all(dir);
+}
+
+// --------------------------------------------------------------------
+
+TEST_CASE("t_38")
+{
+	// Options that are repeated a million times are stored in one go
+
+	const size_t N = 1000000;
+
+	mcfp::config large;
+	large.init(
+		"test [options]",
+		mcfp::make_option<std::vector<std::string>>("input,i", ""),
+		mcfp::make_option<std::vector<int>>("level", ""),
+		mcfp::make_option("verbose,v", ""));
+
+	std::vector<std::string> large_args;
+	for (size_t i = 0; i < N; ++i)
+	{
+		switch (i % 4)
+		{
+			case 0: large_args.emplace_back("--input=in-" + std::to_string(i)); break;
+			case 1: large_args.emplace_back("-i"); large_args.emplace_back("in-" + std::to_string(i)); break;
+			case 2: large_args.emplace_back("--input"); large_args.emplace_back("in-" + std::to_string(i)); break;
+			case 3: large_args.emplace_back("--level=" + std::to_string(i)); break;
+		}
+	}
+
+	std::vector<const char *> argv{ "test", "-v" };
+	for (auto &arg : large_args)
+		argv.emplace_back(arg.c_str());
+
+	std::error_code ec;
+	large.parse(static_cast<int>(argv.size()), argv.data(), ec);
+	CHECK_FALSE(ec);
+
+	// The storage for the values is allocated once, with the exact size,
+	// it did not grow while parsing
+	auto inputs = large.get_if<std::vector<std::string>>("input");
+	REQUIRE(inputs != nullptr);
+	CHECK(inputs->size() == N / 4 * 3);
+	CHECK(inputs->capacity() == inputs->size());
+	CHECK(inputs->front() == "in-0");
+	CHECK(inputs->back() == "in-" + std::to_string(N - 2));
+	CHECK(large.count("input") == static_cast<int>(N / 4 * 3));
+
+	auto levels = large.get_if<std::vector<int>>("level");
+	REQUIRE(levels != nullptr);
+	CHECK(levels->size() == N / 4);
+	CHECK(levels->capacity() == levels->size());
+	CHECK(levels->back() == static_cast<int>(N - 1));
+
+#if __cpp_lib_span >= 202002L
+	// the unconverted arguments are views on argv
+	auto args = large.get<std::span<const std::string_view>>("input");
+	REQUIRE(args.size() == N / 4 * 3);
+	CHECK(args[0].data() == large_args[0].c_str() + std::strlen("--input="));
+	CHECK(args[1].data() == large_args[2].c_str());
+#endif
+
+	CHECK(large.has("verbose"));
+	CHECK(large.operands().empty());
+
+	// there is no limit on the number of options that can be repeated
+	{
+		const size_t M = 40;
+
+		std::vector<std::string> names;
+		for (size_t i = 0; i < M; ++i)
+			names.emplace_back("multi-" + std::to_string(i));
+
+		mcfp::option_set options;
+		for (auto &name : names)
+			options.add(mcfp::make_option<std::vector<int>>(name, ""));
+
+		mcfp::config config;
+		config.init("test [options]", options);
+
+		std::vector<std::string> args;
+		for (size_t i = 0; i < M * 100; ++i)
+			args.emplace_back("--multi-" + std::to_string(i % M) + '=' + std::to_string(i));
+
+		std::vector<const char *> argv{ "test" };
+		for (auto &arg : args)
+			argv.emplace_back(arg.c_str());
+
+		config.parse(static_cast<int>(argv.size()), argv.data(), ec);
+		CHECK_FALSE(ec);
+
+		for (size_t i = 0; i < M; ++i)
+		{
+			auto values = config.get_if<std::vector<int>>(names[i]);
+			REQUIRE(values != nullptr);
+			CHECK(values->size() == 100);
+			CHECK(values->capacity() == 100);
+		}
+	}
+
+	// the time taken grows linearly with the number of values, and the
+	// number of allocations does not grow at all
+	{
+		std::vector<std::string> args;
+		for (size_t i = 0; i < N; ++i)
+			args.emplace_back("--level=" + std::to_string(i));
+
+		auto parse = [&args](size_t n)
+		{
+			std::vector<const char *> argv{ "test" };
+			for (size_t i = 0; i < n; ++i)
+				argv.emplace_back(args[i].c_str());
+
+			mcfp::config config;
+			config.init("test [options]", mcfp::make_option<std::vector<int>>("level", ""));
+
+			std::error_code ec;
+			auto allocations = gAllocations.load();
+			auto start = std::chrono::steady_clock::now();
+
+			config.parse(static_cast<int>(argv.size()), argv.data(), ec);
+
+			auto time = std::chrono::steady_clock::now() - start;
+			allocations = gAllocations.load() - allocations;
+
+			CHECK_FALSE(ec);
+			CHECK(config.get_if<std::vector<int>>("level")->size() == n);
+			return std::make_pair(allocations, time);
+		};
+
+		// the best of a few runs, to reduce noise
+		auto small = parse(N / 10);
+		for (int i = 0; i < 2; ++i)
+			small.second = std::min(small.second, parse(N / 10).second);
+
+		auto large = parse(N);
+
+		CHECK(large.first == small.first);
+		CHECK(large.second < small.second * 10 * 4);
+	}
+}
+
+// --------------------------------------------------------------------
+
+TEST_CASE("t_39")
+{
+	// Options set from environment variables
+
+	auto init = [](mcfp::config &config)
+	{
+		config.init(
+			"test [options]",
+			mcfp::make_option("verbose,v", ""),
+			mcfp::make_option("quiet", ""),
+			mcfp::make_option<int>("cache-size", 10, ""),
+			mcfp::make_option<int>("param_int", ""),
+			mcfp::make_option<std::string>("name", ""),
+			mcfp::make_option<int>("server.port", ""),
+			mcfp::make_option<std::vector<std::string>>("input", ""));
+	};
+
+	const char *const envp[] = {
+		"PATH=/usr/bin:/bin",
+		"MYTOOL_VERBOSE=yes",
+		"MYTOOL_QUIET=0",
+		"MYTOOL_CACHE_SIZE=42",
+		"MYTOOL_PARAM_INT=7",
+		"MYTOOL_NAME=from the environment",
+		"MYTOOL_SERVER__PORT=8080",
+		"MYTOOL_INPUT=c",
+		"OTHER_NAME=other",
+		"MYTOOL_=no name",
+		nullptr
+	};
+
+	{
+		mcfp::config config;
+		init(config);
+
+		const char *const argv[] = { "test", "--name=from the command line", "--input=a", "--input=b", nullptr };
+
+		std::error_code ec;
+		config.parse(4, argv, ec);
+		REQUIRE_FALSE(ec);
+
+		config.parse_environment("MYTOOL_", envp, ec);
+		REQUIRE_FALSE(ec);
+
+		CHECK(config.count("verbose") == 1);
+		CHECK_FALSE(config.has("quiet"));
+		CHECK(config.get<int>("cache-size") == 42);
+		CHECK(config.get<int>("param_int") == 7);
+		CHECK(config.get<int>("server.port") == 8080);
+		CHECK(config.get<std::string>("name") == "from the command line");
+		CHECK(config.get<std::vector<std::string>>("input") == std::vector<std::string>{ "a", "b", "c" });
+
+		// a config file does not override the environment, also not after a reload
+		config.parse_config_text("cache-size=1\nquiet\n", ec);
+		REQUIRE_FALSE(ec);
+		CHECK(config.get<int>("cache-size") == 42);
+		CHECK(config.has("quiet"));
+
+		config.reload_config_text("cache-size=2\n", ec);
+		REQUIRE_FALSE(ec);
+		CHECK(config.get<int>("cache-size") == 42);
+		CHECK_FALSE(config.has("quiet"));
+	}
+
+	for (auto [env, expected] : std::initializer_list<std::tuple<const char *, std::error_code>>{
+		{ "MYTOOL_UNKNOWN=1", make_error_code(mcfp::config_error::unknown_option) },
+		{ "MYTOOL_VERBOSE=maybe", make_error_code(mcfp::config_error::option_does_not_accept_argument) },
+		{ "MYTOOL_CACHE_SIZE=big", std::make_error_code(std::errc::invalid_argument) },
+		{ "MYTOOL_VERBOSE=TRUE", {} },
+		{ "MYTOOL_CACHE_SIZE=", {} },
+		{ "MYTOOL_CACHE-SIZE=1", {} } })
+	{
+		mcfp::config config;
+		init(config);
+
+		const char *const env_vars[] = { env, nullptr };
+
+		std::error_code ec;
+		config.parse_environment("MYTOOL_", env_vars, ec);
+		CHECK(ec == expected);
+	}
+
+	{
+		mcfp::config config;
+		init(config);
+		config.set_ignore_unknown(true);
+
+		const char *const env_vars[] = { "MYTOOL_UNKNOWN=1", "MYTOOL_CACHE_SIZE=3", nullptr };
+
+		std::error_code ec;
+		config.parse_environment("MYTOOL_", env_vars, ec);
+		CHECK_FALSE(ec);
+		CHECK(config.get<int>("cache-size") == 3);
+	}
+
+	{
+		mcfp::config config;
+		init(config);
+
+		CHECK_THROWS_AS(config.parse_environment(""), std::system_error);
+	}
+}
+
+// --------------------------------------------------------------------
+// Differential test of the config file tokenizer against the character
+// by character state machine it replaced
+
+using config_token = std::tuple<std::string, bool, std::string>;
+
+std::error_code legacy_tokenize(std::string_view text, std::vector<config_token> &tokens)
+{
+	auto is_name_char = [](int ch) { return std::isalnum(ch) or ch == '_' or ch == '-'; };
+	auto is_eoln = [](int ch) { return ch == '\n' or ch == '\r' or ch == std::char_traits<char>::eof(); };
+
+	auto handler = [&tokens](const std::string &name, bool has_value, const std::string &value, std::error_code &ec)
+	{
+		tokens.emplace_back(name, has_value, value);
+		if (name == "stop")
+			ec = make_error_code(mcfp::config_error::unknown_option);
+	};
+
+	enum class State { NAME_START, COMMENT, NAME, ASSIGN, VALUE_START, VALUE } state = State::NAME_START;
+
+	std::error_code ec;
+	std::string name, value;
+
+	for (size_t i = 0;; ++i)
+	{
+		int ch = i < text.length() ? static_cast<unsigned char>(text[i]) : std::char_traits<char>::eof();
+
+		switch (state)
+		{
+			case State::NAME_START:
+				if (is_name_char(ch))
+				{
+					name = { static_cast<char>(ch) };
+					value.clear();
+					state = State::NAME;
+				}
+				else if (ch == '#' or ch == ';')
+					state = State::COMMENT;
+				else if (ch != ' ' and ch != '\t' and not is_eoln(ch))
+					ec = make_error_code(mcfp::config_error::invalid_config_file);
+				break;
+
+			case State::COMMENT:
+				if (is_eoln(ch))
+					state = State::NAME_START;
+				break;
+
+			case State::NAME:
+				if (is_name_char(ch))
+					name.insert(name.end(), static_cast<char>(ch));
+				else if (is_eoln(ch))
+				{
+					handler(name, false, {}, ec);
+					state = State::NAME_START;
+				}
+				else
+				{
+					--i;
+					state = State::ASSIGN;
+				}
+				break;
+
+			case State::ASSIGN:
+				if (ch == '=')
+					state = State::VALUE_START;
+				else if (is_eoln(ch))
+				{
+					handler(name, false, {}, ec);
+					state = State::NAME_START;
+				}
+				else if (ch != ' ' and ch != '\t')
+					ec = make_error_code(mcfp::config_error::invalid_config_file);
+				break;
+
+			case State::VALUE_START:
+			case State::VALUE:
+				if (is_eoln(ch))
+				{
+					handler(name, true, value, ec);
+					state = State::NAME_START;
+				}
+				else if (state == State::VALUE)
+					value.insert(value.end(), static_cast<char>(ch));
+				else if (ch != ' ' and ch != '\t')
+				{
+					value = { static_cast<char>(ch) };
+					state = State::VALUE;
+				}
+				break;
+		}
+
+		if (ec or ch == std::char_traits<char>::eof())
+			break;
+	}
+
+	return ec;
+}
+
+std::error_code tokenize(std::string_view text, std::vector<config_token> &tokens, const mcfp::detail::scanner &scan)
+{
+	std::error_code ec;
+
+	mcfp::detail::tokenize_config_text(text, [&tokens](const mcfp::detail::config_section &, std::string_view name, std::optional<std::string_view> value, std::error_code &ec)
+	{
+		tokens.emplace_back(name, value.has_value(), value.value_or(""));
+		if (name == "stop")
+			ec = make_error_code(mcfp::config_error::unknown_option);
+	}, ec, scan);
+
+	return ec;
+}
+
+std::vector<mcfp::detail::scanner> available_scanners()
+{
+	std::vector<mcfp::detail::scanner> result{ mcfp::detail::scanner::scalar(), mcfp::detail::scanner::best() };
+
+#if MCFP_HAS_SSE2
+	result.push_back({ mcfp::detail::skip_line_sse2, mcfp::detail::skip_name_sse2, mcfp::detail::skip_space_sse2 });
+#endif
+#if MCFP_HAS_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		result.push_back({ mcfp::detail::skip_line_avx2, mcfp::detail::skip_name_avx2, mcfp::detail::skip_space_avx2 });
+#endif
+
+	return result;
+}
+
+TEST_CASE("t_26")
+{
+	// Characters that mean something to the tokenizer, and some that do not
+	const std::string_view alphabet[] = {
+		"a", "Z", "0", "_", "-", " ", "\t", "\n", "\r", "=", "#", ";", "!", ".", "\xc3\xa9", std::string_view("\0", 1),
+		"stop", "name-with-a-long_name", "                                   ", "=value with spaces   ",
+		"# a longer comment that spans more than thirty two characters\n",
+	};
+
+	const auto scanners = available_scanners();
+
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<size_t> pick(0, std::size(alphabet) - 1);
+	std::uniform_int_distribution<size_t> length(0, 60);
+
+	for (int i = 0; i < 20000; ++i)
+	{
+		std::string text;
+		for (size_t n = length(rng); n > 0; --n)
+			text += alphabet[pick(rng)];
+
+		std::vector<config_token> expected;
+		auto expected_ec = legacy_tokenize(text, expected);
+
+		for (auto &scan : scanners)
+		{
+			std::vector<config_token> tokens;
+			auto ec = tokenize(text, tokens, scan);
+
+			if (ec != expected_ec or tokens != expected)
+			{
+				FAIL_CHECK("tokenizers differ for " << std::quoted(text));
+				break;
+			}
+		}
+	}
+
+	// The scan routines themselves, at all offsets and with all lengths
+	std::string buffer;
+	for (int i = 0; i < 256; ++i)
+		buffer += alphabet[pick(rng)];
+
+	for (size_t b = 0; b < 64; ++b)
+	{
+		for (size_t e = b; e <= buffer.length(); e += 7)
+		{
+			const char *p = buffer.data() + b, *end = buffer.data() + e;
+
+			for (auto &scan : scanners)
+			{
+				CHECK(scan.skip_line(p, end) == mcfp::detail::skip_line_scalar(p, end));
+				CHECK(scan.skip_name(p, end) == mcfp::detail::skip_name_scalar(p, end));
+				CHECK(scan.skip_space(p, end) == mcfp::detail::skip_space_scalar(p, end));
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+
+TEST_CASE("file_1, * utf::tolerance(0.001)")
+{
+	const std::string_view config_file{ R"(
+# This is a test configuration
+aap=1
+noot = 2
+mies = 	
+pi = 3.14
+s = hello, world!
+verbose
+	)" };
+
+	struct membuf : public std::streambuf
+	{
+		membuf(char * text, size_t length)
+		{
+			this->setg(text, text, text + length);
+		}
+	} buffer(const_cast<char *>(config_file.data()), config_file.length());
+
+	std::istream is(&buffer);
+
+	auto &config = mcfp::config::instance();
+
+	config.init(
+		"test [options]",
+		mcfp::make_option<const char*>("aap", ""),
+		mcfp::make_option<int>("noot", ""),
+		mcfp::make_option<std::string>("mies", ""),
+		mcfp::make_option<float>("pi", ""),
+		mcfp::make_option<std::string>("s", ""),
+		mcfp::make_option("verbose,v", ""));
+	
+	std::error_code ec;
+
+	config.parse_config_file(is, ec);
+
+	CHECK(not ec);
+
+	CHECK(config.has("aap"));
+	CHECK(config.get<std::string>("aap") == "1");
+
+	CHECK(config.has("noot"));
+	CHECK(config.get<int>("noot") == 2);
+
+	CHECK(config.has("pi"));
+	CHECK(std::to_string(config.get<float>("pi")) == std::to_string(3.14));
+
+	CHECK(config.has("s"));
+	CHECK(config.get<std::string>("s") == "hello, world!");
+
+	CHECK(config.has("verbose"));
+
+	CHECK(config.get<std::string_view>("s") == "hello, world!");
+}
+
+TEST_CASE("file_2")
+{
+	auto &config = mcfp::config::instance();
+
+	std::tuple<std::string_view,std::string_view,std::error_code> tests[] = {
+		{ "aap !", "aap", make_error_code(mcfp::config_error::invalid_config_file) },
+		{ "aap=aap", "aap", {} },
+		{ "aap", "aap", make_error_code(mcfp::config_error::missing_argument_for_option) },
+		{ "verbose=1", "verbose", make_error_code(mcfp::config_error::option_does_not_accept_argument) },
+				
+	};
+
+	for (const auto &[config_file, option, err] : tests)
+	{
+		struct membuf : public std::streambuf
+		{
+			membuf(char * text, size_t length)
+			{
+				this->setg(text, text, text + length);
+			}
+		} buffer(const_cast<char *>(config_file.data()), config_file.length());
+
+		std::istream is(&buffer);
+
+		std::error_code ec;
+		config.init(
+			"test [options]",
+			mcfp::make_option<const char*>("aap", ""),
+			mcfp::make_option<int>("noot", ""),
+			mcfp::make_option<float>("pi", ""),
+			mcfp::make_option<std::string>("s", ""),
+			mcfp::make_option("verbose,v", ""));
+		
+		config.parse_config_file(is, ec);
+
+		CHECK(ec == err);
+
+		if (ec == std::errc())
+			CHECK(config.has(option));
+	}
+}
+
+TEST_CASE("file_3")
+{
+	auto &config = mcfp::config::instance();
+
+	config.init(
+		"test [options]",
+		mcfp::make_option<const char*>("aap", ""),
+		mcfp::make_option<int>("noot", ""),
+		mcfp::make_option<std::string>("config", ""));
+	
+	std::error_code ec;
+
+	const char *const argv[] = {
+		"test", "--aap=aap", "--noot=42", "--config=unit-test.conf", nullptr
+	};
+	int argc = sizeof(argv) / sizeof(char*) - 1;
+
+	config.parse(argc, argv);
+
+	config.parse_config_file("config", "bla-bla.conf", { gTestDir.string() }, ec);
+
+	CHECK(not ec);
+
+	CHECK(config.has("aap"));
+	CHECK(config.get<std::string>("aap") == "aap");
+
+	CHECK(config.has("noot"));
+	CHECK(config.get<int>("noot") == 42);
+}
+
+	TEST_CASE("file_4")
+{
+	auto &config = mcfp::config::instance();
+
+	config.init(
+		"test [options]",
+		mcfp::make_option<const char*>("aap", ""),
+		mcfp::make_option<int>("noot", ""),
+		mcfp::make_option<std::string>("config", ""));
+	
+	std::error_code ec;
+
+	const char *const argv[] = {
+		"test", "--aap=aap", nullptr
+	};
+	int argc = sizeof(argv) / sizeof(char*) - 1;
+
+	config.parse(argc, argv);
+
+	config.parse_config_file("config", "unit-test.conf", { gTestDir.string() }, ec);
+
+	CHECK(not ec);
+
+	CHECK(config.has("aap"));
+	CHECK(config.get<std::string>("aap") == "aap");
+
+	CHECK(config.has("noot"));
+	CHECK(config.get<int>("noot") == 3);
+}
+
+TEST_CASE("file_5")
+{
+	mcfp::config config;
+
+	auto init = [&config]()
+	{
+		config.init(
+			"test [options]",
+			mcfp::make_option<int>("noot", ""),
+			mcfp::make_option<std::string>("s", ""),
+			mcfp::make_option<std::vector<std::string>>("input", ""),
+			mcfp::make_option("verbose,v", ""));
+	};
+
+	std::tuple<std::string_view, std::error_code> tests[] = {
+		{ "", {} },
+		{ "\n\r\n\t \n", {} },
+		{ "; comment\n# another = comment\n", {} },
+		{ "noot=1\r\nverbose\r\n", {} },
+		{ "noot = 1", {} },
+		{ "verbose \t", {} },
+		{ "  verbose\n", {} },
+		{ "noot=", {} },
+		{ "noot 1", make_error_code(mcfp::config_error::invalid_config_file) },
+		{ "noot # comment", make_error_code(mcfp::config_error::invalid_config_file) },
+		{ "=1", make_error_code(mcfp::config_error::invalid_config_file) },
+		{ "\xc3\xa9t\xc3\xa9=1", make_error_code(mcfp::config_error::invalid_config_file) },
+		{ "aap=1", make_error_code(mcfp::config_error::unknown_option) },
+		{ "noot\n", make_error_code(mcfp::config_error::missing_argument_for_option) },
+		{ "verbose=", make_error_code(mcfp::config_error::option_does_not_accept_argument) },
+	};
+
+	for (const auto &[text, err] : tests)
+	{
+		init();
+
+		std::error_code ec;
+		config.parse_config_text(text, ec);
+
+		CHECK(ec == err);
+	}
+
+	// values are copied, keep trailing spaces and stop at the end of the line
+	init();
+
+	std::string text = "s = hello, world! \r\ninput=a\ninput = b\nnoot=1\nnoot=2\nverbose\nverbose";
+
+	std::error_code ec;
+	config.parse_config_text(text, ec);
+	std::fill(text.begin(), text.end(), 'x');
+
+	CHECK_FALSE(ec);
+	CHECK(config.get<std::string>("s") == "hello, world! ");
+	CHECK(config.get<std::string_view>("s") == "hello, world! ");
+	CHECK(config.get<std::vector<std::string>>("input") == std::vector<std::string>{ "a", "b" });
+	CHECK(config.get<int>("noot") == 1);
+	CHECK(config.count("verbose") == 2);
+
+	// and the same from a file, which is mapped into memory
+	auto file = std::filesystem::temp_directory_path() / "mcfp-file-5.conf";
+
+	{
+		std::ofstream os(file);
+		for (int i = 0; i < 10000; ++i)
+			os << "# comment " << i << '\n'
+			   << "input = value-" << i << '\n';
+		os << "noot = 42";
+	}
+
+	init();
+	config.parse_config_file(file, ec);
+	std::filesystem::remove(file);
+
+	CHECK_FALSE(ec);
+	CHECK(config.get<int>("noot") == 42);
+
+	auto &input = config.get_ref<std::vector<std::string>>("input").get();
+	REQUIRE(input.size() == 10000);
+	CHECK(input.front() == "value-0");
+	CHECK(input.back() == "value-9999");
+	CHECK(config.get<std::string_view>("input") == "value-9999");
+
+	// a missing file is not an error
+	init();
+	config.parse_config_file(file, ec);
+	CHECK_FALSE(ec);
+	CHECK_FALSE(config.has("noot"));
+
+#if __has_include(<sys/mman.h>)
+	// a pipe is read, a signal while waiting for more does not end it
+	std::filesystem::remove(file);
+	REQUIRE(::mkfifo(file.c_str(), 0600) == 0);
+
+	struct sigaction action = {}, saved, saved_pipe;
+	action.sa_handler = [](int) {};
+	::sigaction(SIGUSR1, &action, &saved); // without SA_RESTART
+
+	// a reader that stops early must not kill the test
+	action.sa_handler = SIG_IGN;
+	::sigaction(SIGPIPE, &action, &saved_pipe);
+
+	auto reader = ::pthread_self();
+	std::thread writer([&]()
+	{
+		std::ofstream os(file);
+		os << "noot = 7\n" << std::flush;
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		::pthread_kill(reader, SIGUSR1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		os << "s = after the signal\n";
+	});
+
+	init();
+	config.parse_config_file(file, ec);
+	writer.join();
+
+	::sigaction(SIGUSR1, &saved, nullptr);
+	::sigaction(SIGPIPE, &saved_pipe, nullptr);
+	std::filesystem::remove(file);
+
+	CHECK_FALSE(ec);
+	CHECK(config.get<int>("noot") == 7);
+	CHECK(config.get<std::string>("s") == "after the signal");
+#endif
 }
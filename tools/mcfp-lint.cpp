@@ -0,0 +1,303 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2022 Maarten L. Hekkelman
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// mcfp-lint, check a large number of config files against a schema
+//
+// The schema lists the options one per line, the name followed by the
+// type, optionally followed by [] for options that may occur more than
+// once. The types are flag, int, unsigned, float, string and path.
+// Empty lines and lines starting with a hash character are ignored.
+//
+//     # the schema for our hosts
+//     threads      unsigned
+//     verbose      flag
+//     input        path[]
+//     cache.size   int
+
+#include <mcfp/mcfp.hpp>
+
+#include <cctype>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// --------------------------------------------------------------------
+
+template <typename T>
+void add_option(mcfp::option_set &options, std::string_view name, bool multi)
+{
+	if (multi)
+		options.add(mcfp::make_option<std::vector<T>>(name, ""));
+	else
+		options.add(mcfp::make_option<T>(name, ""));
+}
+
+// Read the schema in \a text into \a options. The option names are views
+// on \a text. Returns false after printing an error message.
+
+bool read_schema(const fs::path &file, const std::string &text, mcfp::option_set &options)
+{
+	std::string_view rest(text);
+
+	for (size_t line_nr = 1; not rest.empty(); ++line_nr)
+	{
+		auto eoln = rest.find('\n');
+		auto line = rest.substr(0, eoln);
+		rest.remove_prefix(eoln == std::string_view::npos ? rest.length() : eoln + 1);
+
+		auto skip_space = [&line]()
+		{
+			while (not line.empty() and std::isspace(static_cast<unsigned char>(line.front())))
+				line.remove_prefix(1);
+		};
+
+		auto next_word = [&line, &skip_space]()
+		{
+			skip_space();
+			size_t n = 0;
+			while (n < line.length() and not std::isspace(static_cast<unsigned char>(line[n])))
+				++n;
+			auto word = line.substr(0, n);
+			line.remove_prefix(n);
+			return word;
+		};
+
+		skip_space();
+		if (line.empty() or line.front() == '#')
+			continue;
+
+		auto name = next_word();
+		auto type = next_word();
+
+		bool multi = type.length() > 2 and type.substr(type.length() - 2) == "[]";
+		if (multi)
+			type.remove_suffix(2);
+
+		skip_space();
+
+		bool valid = not type.empty() and line.empty();
+
+		if (valid and type == "flag" and not multi)
+			options.add(mcfp::make_option(name, ""));
+		else if (valid and type == "int")
+			add_option<long long>(options, name, multi);
+		else if (valid and type == "unsigned")
+			add_option<unsigned long long>(options, name, multi);
+		else if (valid and type == "float")
+			add_option<double>(options, name, multi);
+		else if (valid and type == "string")
+			add_option<std::string>(options, name, multi);
+		else if (valid and type == "path")
+			add_option<fs::path>(options, name, multi);
+		else
+		{
+			std::cerr << file.string() << ':' << line_nr << ": invalid option specification in schema" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------------------
+// Collect the files to check, directories are searched recursively for
+// files ending in \a extension
+
+bool collect_files(const std::vector<std::string> &operands, std::string_view extension, std::vector<fs::path> &files)
+{
+	for (fs::path operand : operands)
+	{
+		std::error_code ec;
+
+		if (not fs::is_directory(operand, ec))
+		{
+			files.emplace_back(std::move(operand));
+			continue;
+		}
+
+		std::vector<fs::path> found;
+
+		for (fs::recursive_directory_iterator i(operand, ec), end; not ec and i != end; i.increment(ec))
+		{
+			auto name = i->path().filename().string();
+
+			if (name.length() > extension.length() and
+				std::string_view(name).substr(name.length() - extension.length()) == extension and
+				i->is_regular_file(ec))
+			{
+				found.emplace_back(i->path());
+			}
+		}
+
+		if (ec)
+		{
+			std::cerr << operand.string() << ": " << ec.message() << std::endl;
+			return false;
+		}
+
+		std::sort(found.begin(), found.end());
+		files.insert(files.end(), found.begin(), found.end());
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------------------
+// Check \a file, appending the error messages to \a messages. The buffer
+// \a text is reused for each file checked by a thread.
+
+size_t check_file(const mcfp::config &config, const fs::path &file, std::string &text, std::string &messages)
+{
+	std::error_code ec;
+	auto size = fs::file_size(file, ec);
+
+	std::ifstream in;
+	if (not ec)
+	{
+		in.open(file, std::ios::binary);
+		text.resize(size);
+		if (not in.read(text.data(), size))
+			ec = std::make_error_code(std::errc::io_error);
+	}
+
+	if (ec)
+	{
+		messages += file.string() + ": error: " + ec.message() + '\n';
+		return 1;
+	}
+
+	return config.validate_config_text(text, [&](size_t line, size_t column, std::error_code ec, size_t offset)
+	{
+		std::ostringstream s;
+		s << file.string() << ':' << line << ':' << column << ": error: " << ec.message();
+
+		// name the option that was not recognised
+		if (ec == mcfp::config_error::unknown_option)
+		{
+			size_t n = 0;
+			while (offset + n < text.length() and mcfp::detail::is_name_char(text[offset + n]))
+				++n;
+
+			s << " '" << std::string_view(text).substr(offset, n) << '\'';
+		}
+
+		messages += s.str() + '\n';
+	});
+}
+
+// --------------------------------------------------------------------
+
+int main(int argc, char *const argv[])
+{
+	mcfp::config config;
+
+	config.init("usage: mcfp-lint [options] --schema file (file|directory)...",
+		mcfp::make_option("help,h", "Print this help text"),
+		mcfp::make_option<std::string>("schema,s", "The file describing the options"),
+		mcfp::make_option<std::string>("extension", ".conf", "The extension of the config files in directories"),
+		mcfp::make_option<unsigned>("threads,j", 0, "The number of threads to use, default is one per core"),
+		mcfp::make_option("ignore-unknown", "Do not report unknown options"),
+		mcfp::make_option("quiet,q", "Do not print a summary"));
+
+	std::error_code ec;
+	config.parse(argc, argv, ec);
+	if (ec)
+	{
+		std::cerr << "Error parsing arguments: " << ec.message() << std::endl;
+		return 2;
+	}
+
+	if (config.has("help") or not config.has("schema") or config.operands().empty())
+	{
+		std::cerr << config << std::endl;
+		return config.has("help") ? 0 : 2;
+	}
+
+	// The schema text must outlive the options, they refer to it
+	fs::path schema_file = config.get<std::string>("schema");
+	std::ifstream schema_stream(schema_file);
+	if (not schema_stream.is_open())
+	{
+		std::cerr << schema_file.string() << ": cannot open schema" << std::endl;
+		return 2;
+	}
+
+	const std::string schema{ std::istreambuf_iterator<char>(schema_stream), std::istreambuf_iterator<char>() };
+
+	mcfp::option_set options;
+	if (not read_schema(schema_file, schema, options))
+		return 2;
+
+	mcfp::config checker;
+	checker.init("", options);
+	checker.set_ignore_unknown(config.has("ignore-unknown"));
+
+	std::vector<fs::path> files;
+	if (not collect_files(config.operands(), config.get<std::string>("extension"), files))
+		return 2;
+
+	// Check the files in parallel, the messages are printed in the
+	// order of the files afterwards
+	std::vector<std::string> messages(files.size());
+	std::atomic<size_t> next = 0, errors = 0;
+
+	size_t thread_count = config.get<unsigned>("threads");
+	if (thread_count == 0)
+		thread_count = std::thread::hardware_concurrency();
+	thread_count = std::clamp<size_t>(thread_count, 1, std::max<size_t>(files.size(), 1));
+
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&]()
+		{
+			std::string text;
+			for (size_t ix = next++; ix < files.size(); ix = next++)
+				errors += check_file(checker, files[ix], text, messages[ix]);
+		});
+	}
+
+	for (auto &t : threads)
+		t.join();
+
+	for (auto &m : messages)
+		std::cout << m;
+	std::cout.flush();
+
+	if (not config.has("quiet"))
+		std::cerr << files.size() << " files checked, " << errors << " errors found" << std::endl;
+
+	return errors == 0 ? 0 : 1;
+}